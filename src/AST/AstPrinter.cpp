@@ -7,56 +7,73 @@
 std::string AstPrinter::print(const int nodeIdx) {
     if (nodeIdx == -1) return "";
 
-    switch (Node& node = arena.get(nodeIdx); node.type) {
+    switch (const Node node = arena.get(nodeIdx); node.type()) {
         case NodeType::LITERAL: {
-            if (std::holds_alternative<std::monostate>(node.value))
+            if (node.value().isNull())
                 return "null";
 
-            if (std::holds_alternative<double>(node.value)) {
-                std::string s = std::to_string(std::get<double>(node.value));
+            if (node.value().isNumber()) {
+                std::string s = std::to_string(node.value().asNumber());
                 // Remove trailing zeros
                 s.erase(s.find_last_not_of('0') + 1, std::string::npos);
                 if (s.back() == '.') s.pop_back();
                 return s;
             }
 
-            if (std::holds_alternative<std::string>(node.value))
-                return std::get<std::string>(node.value);
+            if (node.value().isString())
+                return node.value().asString();
 
             return "";
         }
         case NodeType::UNARY:
-            return parenthesize(node.op.lexeme, {node.children[0]});
+            return parenthesize(node.lexeme(), {node.child(0)});
         case NodeType::BINARY:
-            return parenthesize(node.op.lexeme, {node.children[0], node.children[1]});
+        case NodeType::ADD_NUM:
+        case NodeType::SUBTRACT_NUM:
+        case NodeType::MULTIPLY_NUM:
+        case NodeType::DIVIDE_NUM:
+        case NodeType::LESS_NUM:
+        case NodeType::LESS_EQUAL_NUM:
+        case NodeType::GREATER_NUM:
+        case NodeType::GREATER_EQUAL_NUM:
+        case NodeType::ADD_STR:
+            return parenthesize(node.lexeme(), {node.child(0), node.child(1)});
         case NodeType::GROUPING:
-            return parenthesize("group", {node.children[0]});
+            return parenthesize("group", {node.child(0)});
         case NodeType::STMT_LIST:
-            return parenthesize("list", node.children);
+            return parenthesize("list", node.children());
         case NodeType::STMT_ECHO:
-            return parenthesize("echo", {node.children[0]});
+            return parenthesize("echo", {node.child(0)});
         case NodeType::STMT_EXPR:
-            return parenthesize("expr", {node.children[0]});
+            return parenthesize("expr", {node.child(0)});
         case NodeType::STMT_BLOCK:
-            return parenthesize("block", node.children);
+            return parenthesize("block", node.children());
         case NodeType::STMT_VAR_DECL:
-            return parenthesize("var " + node.op.lexeme, node.children);
+            return parenthesize("var " + node.lexeme(), node.children());
         case NodeType::VAR_EXPR:
-            return node.op.lexeme;
+            return node.lexeme();
         case NodeType::ASSIGN:
-            return parenthesize("assign " + node.op.lexeme, node.children);
+            return parenthesize("assign " + node.lexeme(), node.children());
         case NodeType::LOGICAL:
-            return parenthesize(node.op.lexeme, {node.children[0], node.children[1]});
+            return parenthesize(node.lexeme(), {node.child(0), node.child(1)});
         case NodeType::STMT_IF:
-            return parenthesize("if", node.children);
+            return parenthesize("if", node.children());
         case NodeType::STMT_WHILE:
-            return parenthesize("while", node.children);
+            return parenthesize("while", node.children());
+        case NodeType::STMT_FUNCTION:
+            return parenthesize("fn " + node.lexeme(), node.children());
+        case NodeType::STMT_RETURN:
+            return parenthesize("return", node.children());
         case NodeType::CALL:
-            return parenthesize("call", node.children);
+            return parenthesize("call", node.children());
         case NodeType::ARRAY:
-            return parenthesize("array", node.children);
+            return parenthesize("array", node.children());
         case NodeType::INDEX_GET:
-            return parenthesize("index", node.children);
+            return parenthesize("index", node.children());
+        case NodeType::INDEX_SET:
+            return parenthesize("index=", node.children());
+        case NodeType::MAP:
+            return parenthesize("map", node.children());
     }
     return "";
 }
@@ -68,4 +85,8 @@ std::string AstPrinter::parenthesize(const std::string& name, const std::vector<
     }
     result += ")";
     return result;
-}
\ No newline at end of file
+}
+
+std::string AstPrinter::parenthesize(const std::string& name, const Children children) {
+    return parenthesize(name, std::vector<int>(children.begin(), children.end()));
+}
@@ -18,6 +18,7 @@ public:
 private:
     Arena& arena;
     std::string parenthesize(const std::string& name, const std::vector<int>& indices);
+    std::string parenthesize(const std::string& name, Children children);
 };
 
 #endif //CIPR_ASTPRINTER_H
\ No newline at end of file
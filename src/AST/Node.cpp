@@ -0,0 +1,68 @@
+#include "Node.h"
+
+#include <algorithm>
+
+int Arena::add(const NodeType type, const Token& op, const uint32_t lexeme,
+               const int* children, const size_t count) {
+    const int index = static_cast<int>(types.size());
+
+    types.push_back(type);
+    ops.push_back(op.type);
+    ranges.push_back({static_cast<uint32_t>(childBuffer.size()), static_cast<uint32_t>(count)});
+    childBuffer.insert(childBuffer.end(), children, children + count);
+    lexemeIds.push_back(lexeme);
+    constantIds.push_back(0);
+    depths.push_back(-1);
+    slots.push_back(-1);
+    extents.push_back(0);
+    tailCalls.push_back(0);
+    deoptCounts.push_back(0);
+    lines.push_back(op.line);
+
+    return index;
+}
+
+void Arena::reserve(const size_t nodes) {
+    const size_t total = types.size() + nodes;
+    types.reserve(total);
+    ops.reserve(total);
+    ranges.reserve(total);
+    lexemeIds.reserve(total);
+    constantIds.reserve(total);
+    depths.reserve(total);
+    slots.reserve(total);
+    extents.reserve(total);
+    tailCalls.reserve(total);
+    deoptCounts.reserve(total);
+    lines.reserve(total);
+    childBuffer.reserve(childBuffer.size() + nodes);
+}
+
+uint32_t Arena::lexemeId(const std::string_view lexeme) {
+    Value name(String::intern(lexeme));
+    const auto [it, added] = lexemeIndex.try_emplace(name.asObject(),
+        static_cast<uint32_t>(lexemes.size()));
+    if (added) {
+        lexemes.push_back(std::move(name));
+    }
+    return it->second;
+}
+
+void Node::setChildren(const std::vector<int>& childIndices) {
+    // Shrinking reuses the node's range; growing moves it to the end of the
+    // buffer and leaves the old one unused.
+    Arena::Range& range = arena->ranges[index];
+    if (childIndices.size() > range.count) {
+        range.first = static_cast<uint32_t>(arena->childBuffer.size());
+        arena->childBuffer.insert(arena->childBuffer.end(), childIndices.begin(), childIndices.end());
+    } else {
+        std::copy(childIndices.begin(), childIndices.end(), arena->childBuffer.begin() + range.first);
+    }
+    range.count = static_cast<uint32_t>(childIndices.size());
+}
+
+void Node::makeLiteral(Value value) {
+    arena->types[index] = NodeType::LITERAL;
+    arena->constantIds[index] = static_cast<uint32_t>(arena->constants.size());
+    arena->constants.push_back(std::move(value));
+}
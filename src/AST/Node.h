@@ -5,15 +5,27 @@
 #ifndef CIPR_NODE_H
 #define CIPR_NODE_H
 
-#include <utility>
-#include <vector>
-#include <deque>
-#include <variant>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "Token/Token.h"
+#include "Value/Value.h"
 
-enum class NodeType {
+enum class NodeType : uint8_t {
     BINARY,
+    // BINARY nodes the Interpreter has specialized for the operand types it
+    // has seen so far. They fall back to BINARY on the first type miss.
+    ADD_NUM,
+    SUBTRACT_NUM,
+    MULTIPLY_NUM,
+    DIVIDE_NUM,
+    LESS_NUM,
+    LESS_EQUAL_NUM,
+    GREATER_NUM,
+    GREATER_EQUAL_NUM,
+    ADD_STR,
     GROUPING,
     LITERAL,
     UNARY,
@@ -32,52 +44,196 @@ enum class NodeType {
     STMT_RETURN,
     ARRAY,
     INDEX_GET,
+    // Children: target, index, assigned value.
+    INDEX_SET,
+    // Children: key and value of each entry in turn.
+    MAP,
 };
 
-struct Node {
-    NodeType type;
-    Token op;
-    Literal value;
+class Arena;
+
+// The children of a node: a range of the Arena's shared child buffer. Like
+// any pointer into a vector it is invalidated when the Arena adds nodes.
+class Children {
+public:
+    Children(const int* first, const uint32_t count) : first(first), count(count) {}
 
-    std::vector<int> children;
+    const int* begin() const { return first; }
+    const int* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int operator[](const size_t i) const { return first[i]; }
+    int back() const { return first[count - 1]; }
 
-    Node(const NodeType type, Token op, Literal value, std::vector<int> children)
-        : type(type), op(std::move(op)), value(std::move(value)),
-          children(std::move(children)) {}
+private:
+    const int* first;
+    uint32_t count;
 };
 
-class Arena {
+// A view of one node. The node's fields live in the Arena's parallel arrays,
+// so a Node is only an index and stays valid as the Arena grows.
+class Node {
 public:
-    int addNode(NodeType type, Token op, Literal value, const std::initializer_list<int> children) {
-        nodes.emplace_back(type, std::move(op), std::move(value), children);
+    Node(Arena& arena, const int index) : arena(&arena), index(index) {}
+
+    NodeType type() const;
+    void setType(NodeType type);
+    TokenType op() const;
+    int line() const;
+    // Interned lexeme of the token that made the node. LITERALs leave it
+    // empty; their text is the node's value.
+    const Value& name() const;
+    const std::string& lexeme() const;
+    // Only LITERAL nodes carry a value.
+    const Value& value() const;
+    // Turns the node into a LITERAL holding `value`, e.g. a folded constant.
+    void makeLiteral(Value value);
+
+    Children children() const;
+    int child(size_t i) const;
+    void setChild(size_t i, int childIndex);
+    void setChildren(const std::vector<int>& childIndices);
+
+    // Filled in by Resolver. Variable references and local declarations are
+    // bound to `slot` of the Environment `depth` scopes out, or of the current
+    // call frame when depth is -1; slot -1 leaves the name to the globals.
+    // STMT_BLOCK records how many slots its Environment needs (0 when it
+    // needs none), STMT_FUNCTION and the root STMT_LIST their frame size.
+    // A STMT_RETURN inside a function whose value is a CALL is a tail call.
+    int depth() const;
+    int slot() const;
+    void bind(int depth, int slot);
+    int slotCount() const;
+    void setSlotCount(int count);
+    int frameSize() const;
+    void setFrameSize(int size);
+    bool tailCall() const;
+    void setTailCall(bool tailCall);
+
+    // Type misses of a quickened BINARY node; past a small limit the node
+    // stays generic instead of flipping back and forth.
+    int deopts() const;
+    void addDeopt();
 
-        return static_cast<int>(nodes.size()) - 1;
-    }
+private:
+    friend class Arena;
 
-    int addNode(NodeType type, Token op, Literal value, const std::vector<int> &children) {
-        nodes.emplace_back(type, std::move(op), std::move(value), children);
+    Arena* arena;
+    int index;
+};
 
-        return static_cast<int>(nodes.size()) - 1;
+// The nodes of one compilation: a script, an include() or a REPL entry.
+// Core holds it while that code runs, and every Function declared in it
+// holds it for as long as the Function lives, so a region is dropped as
+// soon as nothing can run its code any more. Indices are region-local.
+//
+// Nodes are stored as parallel arrays indexed by node, so a walk that only
+// switches on the type touches one byte per node. Children are ranges of
+// one shared index buffer, lexemes are ids into a table of interned names,
+// and literal values sit in a side table of constants.
+class Arena : public std::enable_shared_from_this<Arena> {
+public:
+    Arena() {
+        lexemes.emplace_back(String::intern(""));
+        constants.emplace_back();
     }
 
-    Node& get(const int index) {
-        return nodes[index];
+    // `lexeme` is the text of `op`, which only the Parser can resolve.
+    int addNode(const NodeType type, const Token& op, const std::string_view lexeme,
+                const std::initializer_list<int> children) {
+        return add(type, op, lexemeId(lexeme), children.begin(), children.size());
     }
 
-    const Node& get(const int index) const {
-        return nodes[index];
+    int addNode(const NodeType type, const Token& op, const std::string_view lexeme,
+                const Children children) {
+        return add(type, op, lexemeId(lexeme), children.begin(), children.size());
     }
 
-    size_t size() const {
-        return nodes.size();
+    int addLiteral(const Token& op, Value value) {
+        Node node(*this, add(NodeType::LITERAL, op, 0, nullptr, 0));
+        node.makeLiteral(std::move(value));
+        return node.index;
     }
 
-    void clear() {
-        nodes.clear();
+    // Makes room for `nodes` more nodes with about as many child links.
+    void reserve(size_t nodes);
+
+    Node get(const int index) {
+        return Node(*this, index);
+    }
+
+    size_t size() const {
+        return types.size();
     }
 
 private:
-    std::deque<Node> nodes;
+    friend class Node;
+    friend class ScriptCache;
+
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    std::vector<NodeType> types;
+    std::vector<TokenType> ops;
+    std::vector<Range> ranges;
+    std::vector<uint32_t> lexemeIds;
+    std::vector<uint32_t> constantIds;
+    std::vector<int> depths;
+    std::vector<int> slots;
+    // slotCount of a STMT_BLOCK, frameSize of a STMT_FUNCTION or the root.
+    std::vector<int> extents;
+    std::vector<uint8_t> tailCalls;
+    std::vector<uint8_t> deoptCounts;
+    // Only read to report errors.
+    std::vector<int> lines;
+
+    std::vector<int> childBuffer;
+    std::vector<Value> lexemes;
+    std::unordered_map<const Object*, uint32_t> lexemeIndex;
+    std::vector<Value> constants;
+
+    int add(NodeType type, const Token& op, uint32_t lexeme, const int* children, size_t count);
+    uint32_t lexemeId(std::string_view lexeme);
 };
 
-#endif //CIPR_NODE_H
\ No newline at end of file
+inline NodeType Node::type() const { return arena->types[index]; }
+inline void Node::setType(const NodeType type) { arena->types[index] = type; }
+inline TokenType Node::op() const { return arena->ops[index]; }
+inline int Node::line() const { return arena->lines[index]; }
+inline const Value& Node::name() const { return arena->lexemes[arena->lexemeIds[index]]; }
+inline const std::string& Node::lexeme() const { return name().asString(); }
+inline const Value& Node::value() const { return arena->constants[arena->constantIds[index]]; }
+
+inline Children Node::children() const {
+    const Arena::Range range = arena->ranges[index];
+    return {arena->childBuffer.data() + range.first, range.count};
+}
+
+inline int Node::child(const size_t i) const {
+    return arena->childBuffer[arena->ranges[index].first + i];
+}
+
+inline void Node::setChild(const size_t i, const int childIndex) {
+    arena->childBuffer[arena->ranges[index].first + i] = childIndex;
+}
+
+inline int Node::depth() const { return arena->depths[index]; }
+inline int Node::slot() const { return arena->slots[index]; }
+
+inline void Node::bind(const int depth, const int slot) {
+    arena->depths[index] = depth;
+    arena->slots[index] = slot;
+}
+
+inline int Node::slotCount() const { return arena->extents[index]; }
+inline void Node::setSlotCount(const int count) { arena->extents[index] = count; }
+inline int Node::frameSize() const { return arena->extents[index]; }
+inline void Node::setFrameSize(const int size) { arena->extents[index] = size; }
+inline bool Node::tailCall() const { return arena->tailCalls[index] != 0; }
+inline void Node::setTailCall(const bool tailCall) { arena->tailCalls[index] = tailCall; }
+inline int Node::deopts() const { return arena->deoptCounts[index]; }
+inline void Node::addDeopt() { arena->deoptCounts[index]++; }
+
+#endif //CIPR_NODE_H
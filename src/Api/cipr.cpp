@@ -0,0 +1,227 @@
+#include "cipr.h"
+
+#include "Core/Core.h"
+#include "Common/RuntimeError.h"
+#include "Common/ScriptExit.h"
+#include "Interpreter/Callable.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct cipr_interp {
+    Core core;
+    std::string errors;
+    int exitCode = 0;
+    // Keeps the string handed out by cipr_get_global alive.
+    Value pinned;
+    std::string printed;
+};
+
+namespace {
+    Value toValue(const cipr_value& value) {
+        switch (value.type) {
+            case CIPR_BOOL: return Value(value.boolean != 0);
+            // Some NaN payloads would read back as a boxed pointer.
+            case CIPR_NUMBER: return Value(std::isnan(value.number) ? std::numeric_limits<double>::quiet_NaN() : value.number);
+            case CIPR_STRING:
+            case CIPR_OBJECT: return Value(std::string(value.string ? value.string : "", value.string ? value.length : 0));
+            default: return Value();
+        }
+    }
+
+    // `printed` holds the text of an array or function; strings point into
+    // the Value itself, so both must outlive the result.
+    cipr_value fromValue(const Value& value, std::string& printed) {
+        cipr_value result {};
+        if (value.isBool()) {
+            result.type = CIPR_BOOL;
+            result.boolean = value.asBool();
+        } else if (value.isNumber()) {
+            result.type = CIPR_NUMBER;
+            result.number = value.asNumber();
+        } else if (value.isString()) {
+            result.type = CIPR_STRING;
+            result.string = value.asString().data();
+            result.length = value.asString().size();
+        } else if (value.isObject()) {
+            result.type = CIPR_OBJECT;
+            printed = Interpreter::stringify(value);
+            result.string = printed.data();
+            result.length = printed.size();
+        } else {
+            result.type = CIPR_NULL;
+        }
+        return result;
+    }
+
+    struct HostNative final : Callable {
+        cipr_interp* interp;
+        std::string name;
+        int parameters;
+        cipr_native function;
+        void* userdata;
+
+        HostNative(cipr_interp* interp, std::string name, const int parameters, const cipr_native function,
+                   void* userdata)
+            : interp(interp), name(std::move(name)), parameters(parameters), function(function),
+              userdata(userdata) {}
+
+        int arity() override {
+            return parameters;
+        }
+
+        Value call(Interpreter&, Arguments args) override {
+            std::vector<std::string> printed(args.size());
+            std::vector<cipr_value> values(args.size());
+            for (size_t i = 0; i < args.size(); i++) {
+                values[i] = fromValue(args[i], printed[i]);
+            }
+
+            cipr_value result {};
+            result.type = CIPR_NULL;
+            if (function(interp, values.data(), values.size(), &result, userdata) != 0) {
+                const std::string message = result.type == CIPR_STRING && result.string
+                    ? std::string(result.string, result.length)
+                    : name + " failed.";
+                // Host code has no line of its own.
+                throw RuntimeError(0, message);
+            }
+            return toValue(result);
+        }
+
+        std::string toString() override {
+            return "<native fn " + name + ">";
+        }
+    };
+
+    cipr_status finish(cipr_interp* interp) {
+        if (interp->core.hadError) return CIPR_COMPILE_ERROR;
+        if (interp->core.hadRuntimeError) return CIPR_RUNTIME_ERROR;
+        return CIPR_OK;
+    }
+
+    // Any other exception would reach C code, which cannot catch it.
+    cipr_status fail(cipr_interp* interp, const std::exception& error, const cipr_status status) {
+        interp->errors += "Internal Error: ";
+        interp->errors += error.what();
+        interp->errors += '\n';
+        return status;
+    }
+
+    void begin(cipr_interp* interp) {
+        interp->errors.clear();
+        interp->core.hadError = false;
+        interp->core.hadRuntimeError = false;
+        interp->pinned = Value();
+    }
+}
+
+cipr_interp* cipr_create(const unsigned options) {
+    auto* interp = new cipr_interp();
+    interp->core.setUseVM(options & CIPR_OPTION_VM);
+    interp->core.setOptimize(!(options & CIPR_OPTION_NO_OPTIMIZE));
+    interp->core.setUseCache(options & CIPR_OPTION_CACHE);
+    interp->core.setErrorHandler([interp](const std::string& message) {
+        interp->errors += message;
+        interp->errors += '\n';
+    });
+    return interp;
+}
+
+void cipr_destroy(cipr_interp* interp) {
+    delete interp;
+}
+
+cipr_status cipr_eval(cipr_interp* interp, const char* source, const size_t length) {
+    begin(interp);
+    try {
+        interp->core.runScript(std::string(source, length));
+    } catch (const ScriptExit& exit) {
+        interp->exitCode = exit.code;
+        return CIPR_EXIT;
+    } catch (const std::exception& error) {
+        return fail(interp, error, CIPR_RUNTIME_ERROR);
+    }
+    return finish(interp);
+}
+
+cipr_status cipr_compile(cipr_interp* interp, const char* source, const size_t length, char** buffer,
+                         size_t* size) {
+    begin(interp);
+    std::string bytes;
+    try {
+        if (!interp->core.compileToBuffer(std::string(source, length), bytes)) {
+            if (!interp->core.hadError) {
+                interp->errors = "Script holds constants that cannot be compiled to a buffer.\n";
+            }
+            return CIPR_COMPILE_ERROR;
+        }
+    } catch (const std::exception& error) {
+        return fail(interp, error, CIPR_COMPILE_ERROR);
+    }
+    *buffer = static_cast<char*>(std::malloc(bytes.size()));
+    if (!*buffer) return CIPR_COMPILE_ERROR;
+    std::memcpy(*buffer, bytes.data(), bytes.size());
+    *size = bytes.size();
+    return CIPR_OK;
+}
+
+cipr_status cipr_eval_compiled(cipr_interp* interp, const char* buffer, const size_t size) {
+    begin(interp);
+    try {
+        if (!interp->core.runCompiled(buffer, size)) {
+            interp->errors = "Not a buffer compiled by this version of libcipr.\n";
+            return CIPR_INVALID_BUFFER;
+        }
+    } catch (const ScriptExit& exit) {
+        interp->exitCode = exit.code;
+        return CIPR_EXIT;
+    } catch (const std::exception& error) {
+        return fail(interp, error, CIPR_RUNTIME_ERROR);
+    }
+    return finish(interp);
+}
+
+void cipr_free_buffer(char* buffer) {
+    std::free(buffer);
+}
+
+const char* cipr_last_error(const cipr_interp* interp) {
+    return interp->errors.c_str();
+}
+
+int cipr_exit_code(const cipr_interp* interp) {
+    return interp->exitCode;
+}
+
+void cipr_register_native(cipr_interp* interp, const char* name, const int arity, const cipr_native function,
+                          void* userdata) {
+    interp->core.defineGlobal(name, Value::make<HostNative>(interp, name, arity, function, userdata));
+}
+
+int cipr_get_global(cipr_interp* interp, const char* name, cipr_value* value) {
+    const Value* global = interp->core.lookupGlobal(name);
+    if (!global) return 0;
+    interp->pinned = *global;
+    *value = fromValue(interp->pinned, interp->printed);
+    return 1;
+}
+
+void cipr_set_global(cipr_interp* interp, const char* name, const cipr_value* value) {
+    interp->core.defineGlobal(name, toValue(*value));
+}
+
+void cipr_set_output(cipr_interp* interp, const cipr_output output, void* userdata) {
+    if (!output) {
+        interp->core.setOutputHandler(nullptr);
+        return;
+    }
+    interp->core.setOutputHandler([output, userdata](const std::string& text) {
+        const std::string line = text + '\n';
+        output(line.data(), line.size(), userdata);
+    });
+}
@@ -0,0 +1,104 @@
+/*
+ * C API of libcipr, for running Cipr scripts inside another program.
+ *
+ * An interpreter keeps its globals across evaluations. Nothing here prints
+ * or exits the process: errors are collected for cipr_last_error, exit()
+ * ends only the evaluation that called it, and echo output goes to the
+ * handler set with cipr_set_output (stdout if none is set).
+ *
+ * The runtime is single-threaded: use any number of interpreters, but only
+ * from one thread at a time.
+ */
+
+#ifndef CIPR_API_H
+#define CIPR_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cipr_interp cipr_interp;
+
+typedef enum {
+    CIPR_NULL,
+    CIPR_BOOL,
+    CIPR_NUMBER,
+    CIPR_STRING,
+    /* Arrays and functions. `string` holds their printed form. */
+    CIPR_OBJECT
+} cipr_type;
+
+/* Strings are not NUL-terminated and are only borrowed: a value passed to a
+ * native lasts for the call, one from cipr_get_global until the next call
+ * into the interpreter. Strings handed to the API are copied. */
+typedef struct {
+    cipr_type type;
+    int boolean;
+    double number;
+    const char* string;
+    size_t length;
+} cipr_value;
+
+typedef enum {
+    CIPR_OK,
+    CIPR_COMPILE_ERROR,
+    CIPR_RUNTIME_ERROR,
+    /* The script called exit(); see cipr_exit_code. */
+    CIPR_EXIT,
+    /* A buffer that is damaged or was compiled by another build. */
+    CIPR_INVALID_BUFFER
+} cipr_status;
+
+enum {
+    /* Run on the bytecode VM instead of the tree-walking interpreter. */
+    CIPR_OPTION_VM = 1,
+    /* Skip the Optimizer, like --O0. */
+    CIPR_OPTION_NO_OPTIMIZE = 2,
+    /* Let include() use the on-disk script cache under ~/.cipr/cache. */
+    CIPR_OPTION_CACHE = 4
+};
+
+/* A native called as `name(...)` with exactly `arity` arguments. It fills
+ * in `result` (null if left alone) and returns 0, or returns non-zero to
+ * raise a runtime error whose message is `result` if it is a string. A
+ * string result is copied after the native returns, so it must not point
+ * into the native's own stack frame. */
+typedef int (*cipr_native)(cipr_interp* interp, const cipr_value* args, size_t count,
+                           cipr_value* result, void* userdata);
+
+typedef void (*cipr_output)(const char* text, size_t length, void* userdata);
+
+cipr_interp* cipr_create(unsigned options);
+void cipr_destroy(cipr_interp* interp);
+
+cipr_status cipr_eval(cipr_interp* interp, const char* source, size_t length);
+
+/* Compiles `source` without running it. On success `*buffer` is set to
+ * memory to release with cipr_free_buffer. */
+cipr_status cipr_compile(cipr_interp* interp, const char* source, size_t length,
+                         char** buffer, size_t* size);
+cipr_status cipr_eval_compiled(cipr_interp* interp, const char* buffer, size_t size);
+void cipr_free_buffer(char* buffer);
+
+/* Messages of the last evaluation that failed, one per line; "" if none. */
+const char* cipr_last_error(const cipr_interp* interp);
+/* The code passed to exit() by the last evaluation that returned CIPR_EXIT. */
+int cipr_exit_code(const cipr_interp* interp);
+
+void cipr_register_native(cipr_interp* interp, const char* name, int arity,
+                          cipr_native function, void* userdata);
+
+/* Returns 0 if `name` is not defined. */
+int cipr_get_global(cipr_interp* interp, const char* name, cipr_value* value);
+void cipr_set_global(cipr_interp* interp, const char* name, const cipr_value* value);
+
+/* Receives each echoed line, including its newline. */
+void cipr_set_output(cipr_interp* interp, cipr_output output, void* userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CIPR_API_H */
@@ -0,0 +1,411 @@
+#include "ScriptCache.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char MAGIC[4] = {'C', 'I', 'P', 'C'};
+
+    struct Header {
+        char magic[4];
+        uint32_t format;
+        uint64_t key;
+        // Of everything after the header, so a damaged entry is never run.
+        uint64_t checksum;
+        int32_t root;
+        uint32_t nodes;
+        uint32_t children;
+        uint32_t lexemes;
+        uint32_t constants;
+        // Always zero; spelled out so no byte of an entry goes unchecked.
+        uint32_t reserved;
+    };
+
+    enum ConstantTag : uint8_t { TAG_NULL, TAG_FALSE, TAG_TRUE, TAG_NUMBER, TAG_STRING };
+
+    // Not cryptographic, but eight bytes a step, so hashing a script costs
+    // far less than scanning it.
+    uint64_t hashBytes(const char* data, const size_t size, uint64_t hash) {
+        constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+        const auto mix = [&hash](const uint64_t word) {
+            hash = (hash ^ word) * MULTIPLIER;
+            hash ^= hash >> 32;
+        };
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            mix(word);
+        }
+        for (; i < size; i++) {
+            mix(static_cast<unsigned char>(data[i]));
+        }
+        mix(size);
+        return hash;
+    }
+
+    // Tells apart the builds and compile flags an encoded Arena may come from.
+    uint64_t buildKey(const uint32_t flags) {
+        const std::string_view version = CIPR_VERSION;
+        uint64_t hash = hashBytes(version.data(), version.size(), 0);
+        hash = hashBytes(reinterpret_cast<const char*>(&ScriptCache::FORMAT), sizeof(uint32_t), hash);
+        return hashBytes(reinterpret_cast<const char*>(&flags), sizeof(flags), hash);
+    }
+
+    uint64_t keyOf(const std::string& source, const uint32_t flags) {
+        return hashBytes(source.data(), source.size(), buildKey(flags));
+    }
+
+    class Writer {
+    public:
+        std::string bytes;
+
+        template <typename T>
+        void put(const T& value) {
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void putArray(const std::vector<T>& values) {
+            bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+
+        void putString(const std::string& chars) {
+            put(static_cast<uint32_t>(chars.size()));
+            bytes.append(chars);
+        }
+    };
+
+    // Reads from the mapped entry; every read fails rather than run past it.
+    class Reader {
+    public:
+        Reader(const char* at, const char* end) : at(at), end(end) {}
+
+        template <typename T>
+        bool get(T& value) {
+            if (static_cast<size_t>(end - at) < sizeof(T)) return false;
+            std::memcpy(&value, at, sizeof(T));
+            at += sizeof(T);
+            return true;
+        }
+
+        template <typename T>
+        bool getArray(std::vector<T>& values, const size_t count) {
+            if (static_cast<size_t>(end - at) / sizeof(T) < count) return false;
+            values.resize(count);
+            std::memcpy(values.data(), at, count * sizeof(T));
+            at += count * sizeof(T);
+            return true;
+        }
+
+        bool getString(std::string_view& chars) {
+            uint32_t length;
+            if (!get(length) || static_cast<size_t>(end - at) < length) return false;
+            chars = std::string_view(at, length);
+            at += length;
+            return true;
+        }
+
+        bool done() const { return at == end; }
+
+    private:
+        const char* at;
+        const char* end;
+    };
+}
+
+std::string ScriptCache::defaultDirectory() {
+    const char* home = std::getenv("HOME");
+    if (!home) return "";
+    return std::string(home) + "/.cipr/cache";
+}
+
+std::string ScriptCache::pathFor(const uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.ciprc", static_cast<unsigned long long>(key));
+    return directory + name;
+}
+
+std::shared_ptr<Arena> ScriptCache::load(const std::string& source, const uint32_t flags, int& root) const {
+    if (directory.empty()) return nullptr;
+    const uint64_t key = keyOf(source, flags);
+
+    const int fd = open(pathFor(key).c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return nullptr;
+
+    auto arena = decode(static_cast<const char*>(mapped), size, key, root);
+    munmap(mapped, size);
+    return arena;
+}
+
+void ScriptCache::store(const std::string& source, const uint32_t flags, const Arena& arena, const int root) const {
+    if (directory.empty()) return;
+    const uint64_t key = keyOf(source, flags);
+    const std::string bytes = encode(arena, root, key);
+    if (bytes.empty()) return;
+
+    mkdir(directory.substr(0, directory.rfind('/')).c_str(), 0755);
+    mkdir(directory.c_str(), 0755);
+
+    // Written aside and renamed into place, so concurrent runs of the same
+    // script never map a half-written entry.
+    const std::string path = pathFor(key);
+    const std::string temp = path + "." + std::to_string(getpid());
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+            file.close();
+            std::remove(temp.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+    }
+}
+
+std::string ScriptCache::serialize(const Arena& arena, const int root) {
+    return encode(arena, root, buildKey(0));
+}
+
+std::shared_ptr<Arena> ScriptCache::deserialize(const char* data, const size_t size, int& root) {
+    return decode(data, size, buildKey(0), root);
+}
+
+std::string ScriptCache::encode(const Arena& arena, const int root, const uint64_t key) {
+    Writer out;
+    Header header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.format = FORMAT;
+    header.key = key;
+    header.root = root;
+    header.nodes = static_cast<uint32_t>(arena.types.size());
+    header.children = static_cast<uint32_t>(arena.childBuffer.size());
+    header.lexemes = static_cast<uint32_t>(arena.lexemes.size());
+    header.constants = static_cast<uint32_t>(arena.constants.size());
+    out.put(header);
+
+    out.putArray(arena.types);
+    out.putArray(arena.ops);
+    out.putArray(arena.ranges);
+    out.putArray(arena.lexemeIds);
+    out.putArray(arena.constantIds);
+    // Bindings, frame sizes and quickening are filled in by the Resolver and
+    // Interpreter after the entry is written, so they are left out.
+    out.putArray(arena.lines);
+    out.putArray(arena.childBuffer);
+
+    for (const Value& name : arena.lexemes) {
+        out.putString(name.asString());
+    }
+    for (const Value& constant : arena.constants) {
+        if (constant.isNull()) {
+            out.put(TAG_NULL);
+        } else if (constant.isBool()) {
+            out.put(constant.asBool() ? TAG_TRUE : TAG_FALSE);
+        } else if (constant.isNumber()) {
+            out.put(TAG_NUMBER);
+            out.put(constant.asNumber());
+        } else if (constant.isString()) {
+            out.put(TAG_STRING);
+            out.putString(constant.asString());
+        } else {
+            return "";
+        }
+    }
+
+    const uint64_t checksum = hashBytes(out.bytes.data() + sizeof(Header), out.bytes.size() - sizeof(Header), 0);
+    std::memcpy(out.bytes.data() + offsetof(Header, checksum), &checksum, sizeof(checksum));
+    return std::move(out.bytes);
+}
+
+std::shared_ptr<Arena> ScriptCache::decode(const char* begin, const size_t size, const uint64_t key, int& root) {
+    if (size < sizeof(Header)) return nullptr;
+    Reader in(begin, begin + size);
+    auto arena = std::make_shared<Arena>();
+    Arena& a = *arena;
+
+    Header header {};
+    in.get(header);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.format != FORMAT || header.key != key ||
+        header.reserved != 0 || header.checksum != hashBytes(begin + sizeof(Header), size - sizeof(Header), 0)) return nullptr;
+
+    const size_t n = header.nodes;
+    if (header.root < 0 || static_cast<size_t>(header.root) >= n) return nullptr;
+    if (!in.getArray(a.types, n) || !in.getArray(a.ops, n) || !in.getArray(a.ranges, n) ||
+        !in.getArray(a.lexemeIds, n) || !in.getArray(a.constantIds, n) ||
+        !in.getArray(a.lines, n) || !in.getArray(a.childBuffer, header.children)) return nullptr;
+    a.depths.assign(n, -1);
+    a.slots.assign(n, -1);
+    a.extents.assign(n, 0);
+    a.tailCalls.assign(n, 0);
+    a.deoptCounts.assign(n, 0);
+
+    a.lexemes.clear();
+    a.lexemes.reserve(header.lexemes);
+    a.lexemeIndex.clear();
+    a.lexemeIndex.reserve(header.lexemes);
+    for (uint32_t i = 0; i < header.lexemes; i++) {
+        std::string_view chars;
+        if (!in.getString(chars)) return nullptr;
+        Value name(String::intern(chars));
+        a.lexemeIndex.emplace(name.asObject(), i);
+        a.lexemes.push_back(std::move(name));
+    }
+
+    a.constants.clear();
+    a.constants.reserve(header.constants);
+    for (uint32_t i = 0; i < header.constants; i++) {
+        uint8_t tag;
+        if (!in.get(tag)) return nullptr;
+        switch (tag) {
+            case TAG_NULL: a.constants.emplace_back(); break;
+            case TAG_FALSE: a.constants.emplace_back(false); break;
+            case TAG_TRUE: a.constants.emplace_back(true); break;
+            case TAG_NUMBER: {
+                double number;
+                if (!in.get(number)) return nullptr;
+                // Some NaN payloads would read back as a boxed pointer.
+                if (std::isnan(number)) number = std::numeric_limits<double>::quiet_NaN();
+                a.constants.emplace_back(number);
+                break;
+            }
+            case TAG_STRING: {
+                std::string_view chars;
+                if (!in.getString(chars)) return nullptr;
+                a.constants.emplace_back(std::string(chars));
+                break;
+            }
+            default:
+                return nullptr;
+        }
+    }
+    if (!in.done() || !wellFormed(a, header.root)) return nullptr;
+    root = header.root;
+    return arena;
+}
+
+bool ScriptCache::wellFormed(const Arena& arena, const int root) {
+    const size_t n = arena.types.size();
+    for (size_t i = 0; i < n; i++) {
+        const NodeType type = arena.types[i];
+        if (type > NodeType::MAP || arena.ops[i] > EOF_TOKEN ||
+            arena.lexemeIds[i] >= arena.lexemes.size() || arena.constantIds[i] >= arena.constants.size()) return false;
+
+        const Arena::Range range = arena.ranges[i];
+        if (range.first > arena.childBuffer.size() || range.count > arena.childBuffer.size() - range.first) return false;
+        for (uint32_t c = 0; c < range.count; c++) {
+            // The Parser adds a node after its children, so an earlier
+            // index also rules out cycles. -1 is only an absent optional
+            // initializer, return value or else branch.
+            const int child = arena.childBuffer[range.first + c];
+            const bool optional = type == NodeType::STMT_VAR_DECL || type == NodeType::STMT_RETURN ||
+                                  (type == NodeType::STMT_IF && c == 2);
+            if (child == -1) {
+                if (!optional) return false;
+                continue;
+            }
+            if (child < 0 || static_cast<size_t>(child) >= i) return false;
+        }
+
+        // As many children as the Interpreter and Compiler read.
+        const uint32_t count = range.count;
+        switch (type) {
+            case NodeType::LITERAL:
+            case NodeType::VAR_EXPR:
+                if (count != 0) return false;
+                break;
+            case NodeType::GROUPING:
+            case NodeType::UNARY:
+            case NodeType::ASSIGN:
+            case NodeType::STMT_ECHO:
+            case NodeType::STMT_EXPR:
+            case NodeType::STMT_VAR_DECL:
+            case NodeType::STMT_RETURN:
+                if (count != 1) return false;
+                break;
+            case NodeType::STMT_IF:
+            case NodeType::INDEX_SET:
+                if (count != 3) return false;
+                break;
+            case NodeType::CALL:
+            case NodeType::STMT_FUNCTION:
+                // The callee or body, and up to 255 arguments or parameters.
+                if (count < 1 || count > 256) return false;
+                break;
+            case NodeType::MAP:
+                if (count % 2 != 0) return false;
+                break;
+            case NodeType::STMT_LIST:
+            case NodeType::STMT_BLOCK:
+            case NodeType::ARRAY:
+                break;
+            default:
+                // BINARY and its quickened forms, LOGICAL, INDEX_GET and
+                // STMT_WHILE.
+                if (count != 2) return false;
+                break;
+        }
+    }
+
+    // What runs must be a tree: a node reached through two parents would be
+    // bound by the Resolver for one scope and run in the other. Nodes the
+    // Parser or Optimizer replaced may still list children now used
+    // elsewhere, so only what the root reaches is checked. Parents come
+    // after their children, so walking down from the root sees every
+    // parent of a node before the node itself.
+    if (arena.types[root] != NodeType::STMT_LIST) return false;
+    std::vector<bool> reached(n);
+    reached[root] = true;
+    for (size_t i = root + 1; i-- > 0;) {
+        if (!reached[i]) continue;
+        const Children children {arena.childBuffer.data() + arena.ranges[i].first, arena.ranges[i].count};
+        for (size_t c = 0; c < children.size(); c++) {
+            const int child = children[c];
+            if (child == -1) continue;
+            if (reached[child] || !fits(arena.types[i], c, children.size(), arena.types[child])) return false;
+            reached[child] = true;
+        }
+    }
+    return true;
+}
+
+bool ScriptCache::fits(const NodeType parent, const size_t position, const size_t count, const NodeType child) {
+    const bool statement = child >= NodeType::STMT_LIST && child <= NodeType::STMT_RETURN;
+    const bool declaration = child == NodeType::STMT_VAR_DECL || child == NodeType::STMT_FUNCTION;
+    switch (parent) {
+        case NodeType::STMT_LIST:
+        case NodeType::STMT_BLOCK:
+            // The Resolver finds a scope's declarations among its direct
+            // children only.
+            return child != NodeType::STMT_LIST;
+        case NodeType::STMT_FUNCTION:
+            return position + 1 == count ? child == NodeType::STMT_BLOCK : child == NodeType::VAR_EXPR;
+        case NodeType::STMT_IF:
+        case NodeType::STMT_WHILE:
+            if (position == 0) return !statement;
+            return !declaration && child != NodeType::STMT_LIST;
+        default:
+            return !statement;
+    }
+}
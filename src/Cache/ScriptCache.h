@@ -0,0 +1,50 @@
+#ifndef CIPR_SCRIPTCACHE_H
+#define CIPR_SCRIPTCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "AST/Node.h"
+
+// Compiled scripts on disk, so a script that has not changed since its last
+// run skips the Scanner, Parser and Optimizer. An entry is the Arena of one
+// compilation, named by a hash of the source, the interpreter version and
+// the compile flags, and is mapped back in with mmap.
+class ScriptCache {
+public:
+    // Bump whenever NodeType, TokenType or the Arena's arrays change, so
+    // entries written by an older build are never read.
+    static constexpr uint32_t FORMAT = 3;
+
+    // Entries live in `directory`; an empty one disables the cache.
+    explicit ScriptCache(std::string directory) : directory(std::move(directory)) {}
+
+    // ~/.cipr/cache, or nothing when HOME is unset.
+    static std::string defaultDirectory();
+
+    // `flags` tells apart compilations of the same source, e.g. with and
+    // without the Optimizer. Returns null on a miss.
+    std::shared_ptr<Arena> load(const std::string& source, uint32_t flags, int& root) const;
+    // Best effort: a cache that cannot be written is simply not used.
+    void store(const std::string& source, uint32_t flags, const Arena& arena, int root) const;
+
+    // The same encoding as a standalone buffer, for precompiled scripts.
+    // Returns an empty string for an Arena holding constants it cannot
+    // encode, and null for a buffer that is damaged or from another build.
+    static std::string serialize(const Arena& arena, int root);
+    static std::shared_ptr<Arena> deserialize(const char* data, size_t size, int& root);
+
+private:
+    std::string directory;
+
+    std::string pathFor(uint64_t key) const;
+    static std::string encode(const Arena& arena, int root, uint64_t key);
+    static std::shared_ptr<Arena> decode(const char* data, size_t size, uint64_t key, int& root);
+    // Whether a decoded Arena is a tree the Parser could have built, so a
+    // buffer crafted to pass the checksum cannot index out of bounds.
+    static bool wellFormed(const Arena& arena, int root);
+    // Whether `child` may sit at `position` of `count` children of `parent`.
+    static bool fits(NodeType parent, size_t position, size_t count, NodeType child);
+};
+
+#endif //CIPR_SCRIPTCACHE_H
@@ -0,0 +1,167 @@
+#include "Collector.h"
+
+#include <algorithm>
+#include <chrono>
+#include "Value/Value.h"
+
+void Tracer::visit(const Value& value) {
+    if (!value.isObject())
+        return;
+    if (Traceable* target = value.asObject()->traceable()) {
+        visit(target);
+    }
+}
+
+Traceable::Traceable() {
+    Collector::instance().track(this);
+}
+
+Traceable::~Traceable() {
+    Collector::instance().untrack(this);
+}
+
+Collector& Collector::instance() {
+    // Never destroyed, so objects released during static destruction can
+    // still untrack themselves.
+    static auto* collector = new Collector();
+    return *collector;
+}
+
+void Collector::track(Traceable* object) {
+    object->gcIndex = young.size();
+    young.push_back(object);
+}
+
+void Collector::untrack(Traceable* object) {
+    std::vector<Traceable*>& generation = object->old ? old : young;
+    if (object->old) {
+        oldBytes -= std::min(oldBytes, object->gcBytes);
+    }
+
+    Traceable* last = generation.back();
+    generation[object->gcIndex] = last;
+    last->gcIndex = object->gcIndex;
+    generation.pop_back();
+}
+
+void Collector::collectYoung() {
+    collect(false);
+    if (oldBytes > nextFullBytes) {
+        collect(true);
+    }
+}
+
+size_t Collector::collect(const bool full) {
+    if (collecting)
+        return 0;
+    collecting = true;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Traceable*> candidates = young;
+    if (full) {
+        candidates.insert(candidates.end(), old.begin(), old.end());
+    }
+
+    // Only the generation(s) being collected take part; references from old
+    // objects into the young generation count as outside references.
+    // Start from each object's total reference count, then subtract the
+    // references held by other candidates. An object nobody counts a
+    // reference to yet is still being set up, so it counts as held.
+    for (Traceable* object : candidates) {
+        object->gcRefs = std::max<long>(static_cast<long>(object->references()), 1);
+        object->reached = false;
+    }
+
+    struct Subtract final : Tracer {
+        bool full = false;
+        void visit(Traceable* target) override {
+            if (full || !target->old) target->gcRefs--;
+        }
+    } subtract;
+    subtract.full = full;
+    for (Traceable* object : candidates) {
+        object->trace(subtract);
+    }
+
+    // Whatever is still referenced from outside is live, along with
+    // everything it reaches.
+    std::vector<Traceable*> pending;
+    for (Traceable* object : candidates) {
+        if (object->gcRefs > 0) {
+            object->reached = true;
+            pending.push_back(object);
+        }
+    }
+
+    struct Mark final : Tracer {
+        bool full = false;
+        std::vector<Traceable*>* pending = nullptr;
+        void visit(Traceable* target) override {
+            if ((full || !target->old) && !target->reached) {
+                target->reached = true;
+                pending->push_back(target);
+            }
+        }
+    } mark;
+    mark.full = full;
+    mark.pending = &pending;
+    while (!pending.empty()) {
+        Traceable* object = pending.back();
+        pending.pop_back();
+        object->trace(mark);
+    }
+
+    // Survivors move to the old generation; garbage stays young until the
+    // references dropped below actually free it.
+    std::vector<Traceable*> garbage;
+    std::vector<std::shared_ptr<void>> holds;
+    if (full) {
+        old.clear();
+        oldBytes = 0;
+    }
+    for (Traceable* object : candidates) {
+        if (!object->reached) {
+            object->old = false;
+            object->gcIndex = garbage.size();
+            garbage.push_back(object);
+            holds.push_back(object->hold());
+        } else if (!object->old || full) {
+            object->old = true;
+            object->gcBytes = object->byteSize();
+            object->gcIndex = old.size();
+            old.push_back(object);
+            oldBytes += object->gcBytes;
+        }
+    }
+    young = garbage;
+
+    if (full) {
+        nextFullBytes = std::max(MIN_FULL_BYTES,
+            static_cast<size_t>(static_cast<double>(oldBytes) * growthFactor));
+    }
+
+    for (Traceable* object : garbage) {
+        object->clear();
+    }
+    holds.clear();
+
+    const double pauseMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    statistics.collections++;
+    if (full) statistics.fullCollections++;
+    statistics.freedObjects += garbage.size();
+    statistics.totalPauseMs += pauseMs;
+    statistics.maxPauseMs = std::max(statistics.maxPauseMs, pauseMs);
+    statistics.liveBytes = oldBytes;
+
+    collecting = false;
+    return garbage.size();
+}
+
+void Collector::setYoungThreshold(const size_t objects) {
+    youngThreshold = std::max<size_t>(objects, 1);
+}
+
+void Collector::setGrowthFactor(const double factor) {
+    growthFactor = std::max(factor, 1.0);
+}
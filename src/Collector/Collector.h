@@ -0,0 +1,112 @@
+#ifndef CIPR_COLLECTOR_H
+#define CIPR_COLLECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Value;
+class Traceable;
+
+// Visits the counted references one Traceable holds to others.
+class Tracer {
+public:
+    virtual ~Tracer() = default;
+    virtual void visit(Traceable* target) = 0;
+    void visit(const Value& value);
+};
+
+// Base of every heap object that can reference other objects and so end up
+// in a reference cycle: Environments, arrays, script functions and VM
+// closures and upvalues. Reference counting still frees everything as soon
+// as it is unreachable; the Collector only has to find cycles that nothing
+// outside them points to.
+class Traceable {
+public:
+    Traceable();
+    Traceable(const Traceable&) = delete;
+    Traceable& operator=(const Traceable&) = delete;
+    virtual ~Traceable();
+
+    // Number of counted references to this object, from anywhere.
+    virtual size_t references() const = 0;
+    // Reports each counted reference this object holds.
+    virtual void trace(Tracer& tracer) = 0;
+    // Drops those references, which lets a garbage cycle fall apart.
+    virtual void clear() = 0;
+    // Returns a reference that keeps this object alive while it is cleared.
+    virtual std::shared_ptr<void> hold() = 0;
+    // Rough heap footprint, for the growth threshold and gc_stats().
+    virtual size_t byteSize() const = 0;
+
+private:
+    friend class Collector;
+
+    size_t gcIndex = 0;
+    size_t gcBytes = 0;
+    long gcRefs = 0;
+    bool old = false;
+    bool reached = false;
+};
+
+// Generational cycle collector over every live Traceable. Reference counts
+// say how many references each object has; subtracting the ones held by
+// other tracked objects leaves those held from outside (the C++ stack, the
+// interpreter's frames, the globals), and whatever those cannot reach is a
+// garbage cycle. New objects start young and are promoted after surviving
+// one collection; old objects are only examined by full collections.
+class Collector {
+public:
+    struct Stats {
+        uint64_t collections = 0;
+        uint64_t fullCollections = 0;
+        uint64_t freedObjects = 0;
+        double totalPauseMs = 0;
+        double maxPauseMs = 0;
+        size_t liveBytes = 0;
+    };
+
+    static Collector& instance();
+
+    // Collects the young generation once it holds `youngThreshold` objects,
+    // and everything once old objects outgrow `growthFactor` times the live
+    // bytes left by the previous full collection. Call only where every
+    // object in use is held by a Value or shared_ptr.
+    void maybeCollect() {
+        if (young.size() >= youngThreshold) {
+            collectYoung();
+        }
+    }
+
+    // Returns the number of objects found to be garbage.
+    size_t collect(bool full);
+
+    void setYoungThreshold(size_t objects);
+    void setGrowthFactor(double factor);
+
+    const Stats& stats() const { return statistics; }
+    size_t trackedObjects() const { return young.size() + old.size(); }
+
+private:
+    friend class Traceable;
+
+    static constexpr size_t MIN_FULL_BYTES = 1 << 20;
+
+    std::vector<Traceable*> young;
+    std::vector<Traceable*> old;
+    size_t youngThreshold = 2000;
+    double growthFactor = 2.0;
+    size_t oldBytes = 0;
+    size_t nextFullBytes = MIN_FULL_BYTES;
+    bool collecting = false;
+    Stats statistics;
+
+    Collector() = default;
+
+    void track(Traceable* object);
+    void untrack(Traceable* object);
+    void collectYoung();
+};
+
+#endif //CIPR_COLLECTOR_H
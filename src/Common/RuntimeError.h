@@ -7,15 +7,13 @@
 
 #include <stdexcept>
 #include <string>
-#include <utility>
-#include "Token/Token.h"
 
 class RuntimeError final : public std::runtime_error {
 public:
-    const Token token;
+    const int line;
 
-    RuntimeError(Token token, const std::string& message)
-        : std::runtime_error(message), token(std::move(token)) {}
+    RuntimeError(const int line, const std::string& message)
+        : std::runtime_error(message), line(line) {}
 };
 
 #endif //CIPR_RUNTIMEERROR_H
\ No newline at end of file
@@ -0,0 +1,10 @@
+#ifndef CIPR_SCRIPTEXIT_H
+#define CIPR_SCRIPTEXIT_H
+
+// Thrown by exit(). Whoever started the script catches it: main() ends the
+// process with `code`, an embedding host gets it back from cipr_eval.
+struct ScriptExit {
+    const int code;
+};
+
+#endif //CIPR_SCRIPTEXIT_H
@@ -6,15 +6,18 @@
 #include "Scanner/Scanner.h"
 #include "../AST/AstPrinter.h"
 #include "Parser/Parser.h"
+#include "Optimizer/Optimizer.h"
+#include "Resolver/Resolver.h"
+#include "VM/Compiler.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <cstdlib>
+#include <climits>
+#include <sys/stat.h>
 
-bool Core::hadError = false;
-
-Core::Core() : interpreter(arena) {}
+Core::Core() : interpreter(*this), vm(interpreter), cache(ScriptCache::defaultDirectory()) {}
 
 void Core::loadConfig() {
     const char* home = std::getenv("HOME");
@@ -25,22 +28,26 @@ void Core::loadConfig() {
     if (file.is_open()) {
         std::stringstream buffer;
         buffer << file.rdbuf();
-        run(buffer.str());
+        runScript(buffer.str());
         hadError = false;
     }
 }
 
-void Core::runFile(const std::string& path) {
+int Core::runFile(const std::string& path) {
     std::ifstream file(path);
     if (!file.is_open()) {
-        std::cerr << "Could not open file: " << path << std::endl;
-        exit(74);
+        if (errorHandler) {
+            errorHandler("Could not open file: " + path);
+        } else {
+            std::cerr << "Could not open file: " << path << std::endl;
+        }
+        return 74;
     }
     std::stringstream buffer;
     buffer << file.rdbuf();
-    run(buffer.str());
+    runScript(buffer.str());
 
-    if (hadError) exit(65);
+    return hadError ? 65 : 0;
 }
 
 void Core::runPrompt() {
@@ -77,20 +84,160 @@ void Core::runPrompt() {
 }
 
 void Core::run(const std::string& source) {
-    Scanner scanner(source);
+    int rootIndex;
+    // Functions declared in this code keep the region alive past this call.
+    if (const auto arena = compile(source, false, rootIndex)) {
+        execute(*arena, rootIndex);
+    }
+}
+
+void Core::runScript(const std::string& source) {
+    int rootIndex;
+    if (const auto arena = compile(source, useCache, rootIndex)) {
+        execute(*arena, rootIndex);
+    }
+}
+
+namespace {
+    std::string canonicalPath(const std::string& path) {
+        char resolved[PATH_MAX];
+        return realpath(path.c_str(), resolved) ? std::string(resolved) : std::string();
+    }
+}
+
+bool Core::include(const std::string& filename, const bool reload) {
+    std::string path = canonicalPath(filename);
+    if (path.empty()) {
+        if (const char* home = std::getenv("HOME")) {
+            path = canonicalPath(std::string(home) + "/.cipr/libs/" + filename);
+        }
+    }
+
+    struct stat info {};
+    if (path.empty() || stat(path.c_str(), &info) != 0)
+        return false;
+
+#ifdef __APPLE__
+    const timespec& mtime = info.st_mtimespec;
+#else
+    const timespec& mtime = info.st_mtim;
+#endif
+    Module current;
+    current.mtimeNs = static_cast<int64_t>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+    current.size = info.st_size;
+    current.inode = info.st_ino;
+
+    if (const auto it = modules.find(path); !reload && it != modules.end() &&
+        it->second.mtimeNs == current.mtimeNs && it->second.size == current.size &&
+        it->second.inode == current.inode) {
+        moduleStatistics.hits++;
+        return true;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string source = buffer.str();
+    moduleStatistics.misses++;
+
+    // The file's syntax errors are reported but are not the includer's:
+    // they must neither fail its run nor stop later includes compiling.
+    const bool errorsBefore = hadError;
+    hadError = false;
+    int rootIndex;
+    const auto arena = compile(source, useCache, rootIndex);
+    hadError = errorsBefore;
+    if (!arena) {
+        modules.erase(path);
+        return false;
+    }
+
+    Node root = arena->get(rootIndex);
+    if (root.type() == NodeType::STMT_LIST) {
+        for (const int child : root.children()) {
+            const Node statement = arena->get(child);
+            if (statement.type() == NodeType::STMT_VAR_DECL || statement.type() == NodeType::STMT_FUNCTION) {
+                current.names.push_back(statement.name());
+            }
+        }
+    }
+
+    // Recorded before it runs, so a file that includes itself, directly or
+    // through others, stops there.
+    modules[path] = std::move(current);
+    execute(*arena, rootIndex);
+    return true;
+}
+
+std::shared_ptr<Arena> Core::compile(const std::string& source, const bool cached, int& root) {
+    const uint32_t flags = optimize ? 1 : 0;
+    if (cached) {
+        if (auto arena = cache.load(source, flags, root)) return arena;
+    }
+
+    Scanner scanner(source, *this);
     const std::vector<Token> tokens = scanner.scanTokens();
 
-    Parser parser(tokens, arena);
-    const int rootIndex = parser.parse();
+    auto arena = std::make_shared<Arena>();
+    Parser parser(source, tokens, *arena, *this);
+    root = parser.parse();
 
     if (hadError)
-        return;
+        return nullptr;
 
+    if (optimize) {
+        Optimizer optimizer(*arena);
+        root = optimizer.optimize(root);
+    }
+
+    if (cached) {
+        cache.store(source, flags, *arena, root);
+    }
+    return arena;
+}
+
+void Core::execute(Arena& arena, const int rootIndex) {
     // Optional: Print AST only in debug mode or if requested?
     // AstPrinter printer(arena);
     // std::cout << "AST: " << printer.print(rootIndex) << std::endl;
 
-    interpreter.interpret(rootIndex);
+    if (useVM) {
+        std::shared_ptr<VMFunction> script;
+        try {
+            Compiler compiler(arena, vm);
+            script = compiler.compile(rootIndex);
+        } catch (const Compiler::CompileError& e) {
+            error(e.line, e.what());
+            return;
+        }
+        vm.interpret(script);
+        return;
+    }
+
+    Resolver resolver(arena);
+    resolver.resolve(rootIndex);
+
+    interpreter.interpret(arena, rootIndex);
+}
+
+bool Core::compileToBuffer(const std::string& source, std::string& buffer) {
+    int rootIndex;
+    const auto arena = compile(source, false, rootIndex);
+    if (!arena)
+        return false;
+    buffer = ScriptCache::serialize(*arena, rootIndex);
+    return !buffer.empty();
+}
+
+bool Core::runCompiled(const char* data, const size_t size) {
+    int rootIndex;
+    const auto arena = ScriptCache::deserialize(data, size, rootIndex);
+    if (!arena)
+        return false;
+    execute(*arena, rootIndex);
+    return true;
 }
 
 void Core::error(const int line, const std::string& message) {
@@ -98,6 +245,27 @@ void Core::error(const int line, const std::string& message) {
 }
 
 void Core::report(const int line, const std::string& where, const std::string& message) {
-    std::cerr << "[line " << line << "] Error" << where << ": " << message << std::endl;
     hadError = true;
+    if (errorHandler) {
+        errorHandler("[line " + std::to_string(line) + "] Error" + where + ": " + message);
+        return;
+    }
+    std::cerr << "[line " << line << "] Error" << where << ": " << message << std::endl;
+}
+
+void Core::runtimeError(const RuntimeError& error) {
+    hadRuntimeError = true;
+    if (errorHandler) {
+        errorHandler("Runtime Error: " + std::string(error.what()) + "\n[line " + std::to_string(error.line) + "]");
+        return;
+    }
+    std::cerr << "Runtime Error: " << error.what() << "\n[line " << error.line << "]" << std::endl;
+}
+
+void Core::print(const std::string& text) {
+    if (outputHandler) {
+        outputHandler(text);
+        return;
+    }
+    std::cout << text << std::endl;
 }
\ No newline at end of file
@@ -6,26 +6,109 @@
 #define CIPR_CORE_H
 
 #include "AST/Node.h"
+#include "Cache/ScriptCache.h"
+#include "Common/RuntimeError.h"
+#include "EventLoop/EventLoop.h"
+#include "Http/HttpClient.h"
 #include "Interpreter/Interpreter.h"
+#include "VM/VM.h"
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 class Core {
 public:
     Core();
 
-    void runFile(const std::string& path);
+    // Returns the process exit status: 0, or 65/74 for a script with syntax
+    // errors or one that cannot be read.
+    int runFile(const std::string& path);
     void runPrompt();
     void run(const std::string& source);
+    // Like run, for the source of a script file, ~/.ciprrc or an include():
+    // goes through the ScriptCache unless it is turned off.
+    void runScript(const std::string& source);
     void loadConfig();
 
-    static void error(int line, const std::string& message);
-    static bool hadError;
+    // A file run by include(), keyed by its canonical path. It is run again
+    // only once it changes on disk or reload() asks for it.
+    struct Module {
+        int64_t mtimeNs = 0;
+        int64_t size = 0;
+        uint64_t inode = 0;
+        // Globals declared at the file's top level.
+        std::vector<Value> names;
+    };
+
+    struct ModuleStats {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    // Finds `filename` relative to the working directory, then in
+    // ~/.cipr/libs/, and runs it unless it is an unchanged module. Returns
+    // false if there is no such file or it does not compile.
+    bool include(const std::string& filename, bool reload);
+    const std::unordered_map<std::string, Module>& getModules() const { return modules; }
+    const ModuleStats& moduleStats() const { return moduleStatistics; }
+
+    // Watches and timers for run_loop().
+    EventLoop& getLoop() { return loop; }
+    // Pooled connections for http_get and http_post.
+    HttpClient& getHttp() { return http; }
+
+    // Runs scripts on the bytecode VM instead of the tree-walking Interpreter.
+    void setUseVM(bool enabled) { useVM = enabled; }
+    // Runs the Optimizer over each parsed script (--O1, the default).
+    void setOptimize(bool enabled) { optimize = enabled; }
+    // Reads and writes compiled scripts under ~/.cipr/cache (--no-cache turns it off).
+    void setUseCache(bool enabled) { useCache = enabled; }
+
+    // Compiles `source` into a self-contained buffer for runCompiled.
+    // Returns false after a syntax error.
+    bool compileToBuffer(const std::string& source, std::string& buffer);
+    // Runs a buffer from compileToBuffer. Returns false if it is not one
+    // this build wrote.
+    bool runCompiled(const char* data, size_t size);
+
+    Value* lookupGlobal(const std::string& name) { return interpreter.getGlobals().lookup(name); }
+    void defineGlobal(const std::string& name, const Value& value) { interpreter.getGlobals().define(name, value); }
+
+    // Receives one message or echoed line at a time, without the newline.
+    // Unset handlers write to std::cerr and std::cout.
+    using Handler = std::function<void(const std::string& text)>;
+    void setErrorHandler(Handler handler) { errorHandler = std::move(handler); }
+    void setOutputHandler(Handler handler) { outputHandler = std::move(handler); }
+
+    void error(int line, const std::string& message);
+    void report(int line, const std::string& where, const std::string& message);
+    void runtimeError(const RuntimeError& error);
+    void print(const std::string& text);
+
+    // Set by syntax and runtime errors; whoever runs the code clears them.
+    bool hadError = false;
+    bool hadRuntimeError = false;
 
 private:
-    Arena arena;
     Interpreter interpreter;
+    VM vm;
+    bool useVM = false;
+    bool optimize = true;
+    bool useCache = true;
+    ScriptCache cache;
+    std::unordered_map<std::string, Module> modules;
+    ModuleStats moduleStatistics;
+    EventLoop loop;
+    HttpClient http;
+    Handler errorHandler;
+    Handler outputHandler;
 
-    static void report(int line, const std::string& where, const std::string& message);
+    // Scans, parses and optimizes `source`, or loads all that from the
+    // cache. Returns null after a syntax error.
+    std::shared_ptr<Arena> compile(const std::string& source, bool cached, int& root);
+    void execute(Arena& arena, int root);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "Daemon.h"
+
+#include "Core/Core.h"
+#include "Common/ScriptExit.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// A request is a 4-byte payload length carrying the client's stdin, stdout,
+// stderr and working directory as SCM_RIGHTS descriptors, then the payload:
+// NUL-terminated strings for the script path, its flags, an empty string,
+// and the client's environment. The reply is the 4-byte exit status.
+namespace {
+    constexpr int FD_COUNT = 4;
+    constexpr uint32_t MAX_PAYLOAD = 16 * 1024 * 1024;
+    // Exit status for a request the daemon dropped (EX_SOFTWARE).
+    constexpr int FAILED = 70;
+
+    bool writeAll(const int fd, const char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t written = write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool readAll(const int fd, char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t got = read(fd, data, size);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            data += got;
+            size -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    bool addressOf(const std::string& path, sockaddr_un& address) {
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+        address = {};
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    int connectTo(const sockaddr_un& address) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // The socket is private to its owner, but other users could still reach
+    // it through a more permissive directory.
+    bool peerIsOwner(const int fd) {
+#ifdef __linux__
+        ucred credentials {};
+        socklen_t size = sizeof(credentials);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) return false;
+        return credentials.uid == geteuid();
+#else
+        uid_t uid;
+        gid_t gid;
+        if (getpeereid(fd, &uid, &gid) != 0) return false;
+        return uid == geteuid();
+#endif
+    }
+
+    // Reads the length prefix and the descriptors that arrive with it.
+    bool receiveHeader(const int connection, uint32_t& length, int (&fds)[FD_COUNT]) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * FD_COUNT)];
+        iovec part { &length, sizeof(length) };
+        msghdr message {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t got;
+        do {
+            got = recvmsg(connection, &message, 0);
+        } while (got < 0 && errno == EINTR);
+        if (got <= 0) return false;
+
+        const cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+            header->cmsg_len != CMSG_LEN(sizeof(int) * FD_COUNT)) return false;
+        std::memcpy(fds, CMSG_DATA(header), sizeof(int) * FD_COUNT);
+
+        const auto rest = sizeof(length) - static_cast<size_t>(got);
+        return readAll(connection, reinterpret_cast<char*>(&length) + got, rest) && length <= MAX_PAYLOAD;
+    }
+
+    // Opens /dev/null in place of a closed stdin, stdout or stderr, so no
+    // socket or received descriptor ever lands on 0-2.
+    void holdStdio() {
+        for (int fd = 0; fd < 3; fd++) {
+            if (fcntl(fd, F_GETFD) < 0) open("/dev/null", O_RDWR);
+        }
+    }
+
+    // Takes on the client's environment in place of the daemon's.
+    void replaceEnvironment(const std::vector<const char*>& entries) {
+        std::vector<std::string> names;
+        for (char** entry = environ; *entry; entry++) {
+            const char* equals = std::strchr(*entry, '=');
+            if (equals) names.emplace_back(*entry, static_cast<size_t>(equals - *entry));
+        }
+        for (const std::string& name : names) unsetenv(name.c_str());
+        for (const char* entry : entries) {
+            const char* equals = std::strchr(entry, '=');
+            if (equals) setenv(std::string(entry, equals).c_str(), equals + 1, 1);
+        }
+    }
+}
+
+std::string Daemon::defaultPath() {
+    const char* home = std::getenv("HOME");
+    if (!home) return "";
+    return std::string(home) + "/.cipr/daemon.sock";
+}
+
+int Daemon::listen() {
+    sockaddr_un address {};
+    if (!addressOf(path, address)) {
+        std::cerr << "Invalid socket path: " << path << std::endl;
+        return 64;
+    }
+    if (const int other = connectTo(address); other >= 0) {
+        close(other);
+        std::cerr << "A daemon is already listening on " << path << std::endl;
+        return 69;
+    }
+
+    holdStdio();
+
+    // Left behind by a daemon that did not shut down cleanly.
+    unlink(path.c_str());
+    if (path == defaultPath()) {
+        mkdir(path.substr(0, path.rfind('/')).c_str(), 0755);
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    const mode_t mask = umask(0077);
+    const bool bound = listener >= 0 && bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    umask(mask);
+    if (!bound || ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        listener = -1;
+        return 74;
+    }
+    // Kept from the commands scripts start with run().
+    fcntl(listener, F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+void Daemon::serve(Core& core) const {
+    // Finished children are reaped by the kernel, and a client that hangs up
+    // early must not take the daemon down.
+    std::signal(SIGCHLD, SIG_IGN);
+    std::signal(SIGPIPE, SIG_IGN);
+    // Anything still buffered would otherwise be written again by every child.
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    while (true) {
+        const int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) continue;
+        if (!peerIsOwner(connection)) {
+            close(connection);
+            continue;
+        }
+
+        // The child reads the request itself, so a slow client holds up no
+        // one but itself.
+        if (fork() == 0) {
+            close(listener);
+            fcntl(connection, F_SETFD, FD_CLOEXEC);
+            std::signal(SIGCHLD, SIG_DFL);
+            std::signal(SIGPIPE, SIG_DFL);
+            _exit(handle(core, connection));
+        }
+        close(connection);
+    }
+}
+
+int Daemon::handle(Core& core, const int connection) {
+    uint32_t length = 0;
+    int fds[FD_COUNT];
+    if (!receiveHeader(connection, length, fds)) return FAILED;
+    std::string payload(length, '\0');
+    if (!readAll(connection, payload.data(), length) || payload.empty() || payload.back() != '\0') return FAILED;
+
+    std::vector<const char*> strings;
+    for (size_t at = 0; at < payload.size(); at += std::strlen(payload.c_str() + at) + 1) {
+        strings.push_back(payload.c_str() + at);
+    }
+
+    for (int target = 0; target < 3; target++) {
+        dup2(fds[target], target);
+        close(fds[target]);
+    }
+    const bool moved = fchdir(fds[3]) == 0;
+    close(fds[3]);
+    if (!moved) return FAILED;
+
+    // The daemon's own flags only applied to ~/.ciprrc.
+    core.setUseVM(false);
+    core.setOptimize(true);
+    core.setUseCache(true);
+    size_t i = 1;
+    for (; i < strings.size() && *strings[i]; i++) {
+        const std::string flag = strings[i];
+        if (flag == "--vm") {
+            core.setUseVM(true);
+        } else if (flag == "--O0" || flag == "--O1") {
+            core.setOptimize(flag == "--O1");
+        } else if (flag == "--no-cache") {
+            core.setUseCache(false);
+        }
+    }
+    std::vector<const char*> environment;
+    for (i++; i < strings.size(); i++) environment.push_back(strings[i]);
+    replaceEnvironment(environment);
+
+    int status;
+    try {
+        status = core.runFile(strings[0]);
+    } catch (const ScriptExit& exit) {
+        status = exit.code;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    const int32_t reply = status;
+    writeAll(connection, reinterpret_cast<const char*>(&reply), sizeof(reply));
+    return status;
+}
+
+bool Daemon::run(const std::string& script, const std::vector<std::string>& flags, int& status) const {
+    sockaddr_un address {};
+    if (!addressOf(path, address)) return false;
+    holdStdio();
+    const int connection = connectTo(address);
+    if (connection < 0) return false;
+
+    std::string payload = script + '\0';
+    for (const std::string& flag : flags) payload += flag + '\0';
+    payload += '\0';
+    for (char** entry = environ; *entry; entry++) {
+        payload += *entry;
+        payload += '\0';
+    }
+    const auto length = static_cast<uint32_t>(payload.size());
+
+    const int directory = open(".", O_RDONLY);
+    const int fds[FD_COUNT] = {0, 1, 2, directory};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    iovec part { const_cast<uint32_t*>(&length), sizeof(length) };
+    msghdr message {};
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    const bool sent = sendmsg(connection, &message, 0) == static_cast<ssize_t>(sizeof(length)) &&
+        writeAll(connection, payload.data(), payload.size());
+    if (directory >= 0) close(directory);
+
+    int32_t reply;
+    if (!sent || !readAll(connection, reinterpret_cast<char*>(&reply), sizeof(reply))) {
+        std::cerr << "The daemon on " << path << " dropped the request." << std::endl;
+        reply = FAILED;
+    }
+    close(connection);
+    status = reply;
+    return true;
+}
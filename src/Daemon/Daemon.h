@@ -0,0 +1,39 @@
+#ifndef CIPR_DAEMON_H
+#define CIPR_DAEMON_H
+
+#include <string>
+#include <vector>
+
+class Core;
+
+// Keeps one warm Core, with its natives registered and ~/.ciprrc already
+// run, behind a Unix socket. Each script sent to it runs in a forked copy
+// of that state, so a script costs a fork() rather than a cold start, and
+// requests never see each other's globals.
+class Daemon {
+public:
+    explicit Daemon(std::string path) : path(std::move(path)) {}
+
+    // ~/.cipr/daemon.sock, or nothing when HOME is unset.
+    static std::string defaultPath();
+
+    // Binds the socket. Returns 0, or an exit status if another daemon
+    // already has it or it cannot be bound.
+    int listen();
+    // Serves requests until the process is killed. Clients that connect
+    // between listen() and serve() wait in the backlog.
+    [[noreturn]] void serve(Core& core) const;
+
+    // Runs `script` in the daemon with this process's stdin, stdout, stderr,
+    // working directory and environment, and sets `status` to its exit
+    // status. Returns false if no daemon is listening.
+    bool run(const std::string& script, const std::vector<std::string>& flags, int& status) const;
+
+private:
+    std::string path;
+    int listener = -1;
+
+    static int handle(Core& core, int connection);
+};
+
+#endif //CIPR_DAEMON_H
@@ -6,34 +6,76 @@
 
 #include "Common/RuntimeError.h"
 
-void Environment::define(const std::string& name, const Literal& value) {
+void Environment::define(const std::string& name, const Value& value) {
+    values[Value(String::intern(name))] = value;
+}
+
+void Environment::define(const Value& name, const Value& value) {
     values[name] = value;
 }
 
-Literal Environment::get(const Token& name) {
-    const auto it = values.find(name.lexeme);
+Value Environment::get(const Value& name, const int line) {
+    const auto it = values.find(name);
     if (it != values.end()) {
         return it->second;
     }
 
     if (enclosing != nullptr) {
-       return enclosing->get(name);
+       return enclosing->get(name, line);
     }
 
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+    throw RuntimeError(line, "Undefined variable '" + name.asString() + "'.");
 }
 
-void Environment::assign(const Token& name, const Literal &value) {
-    const auto it = values.find(name.lexeme);
+void Environment::assign(const Value& name, const Value &value, const int line) {
+    const auto it = values.find(name);
     if (it != values.end()) {
         it->second = value;
         return;
     }
 
     if (enclosing != nullptr) {
-        enclosing->assign(name, value);
+        enclosing->assign(name, value, line);
         return;
     }
 
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+    throw RuntimeError(line, "Undefined variable '" + name.asString() + "'.");
+}
+
+Value* Environment::lookup(const std::string& name) {
+    const auto it = values.find(Value(String::intern(name)));
+    return it != values.end() ? &it->second : nullptr;
+}
+
+Value& Environment::at(int depth, const int slot) {
+    Environment* environment = this;
+    while (depth-- > 0) {
+        environment = environment->enclosing.get();
+    }
+    return environment->slots[slot];
+}
+
+void Environment::trace(Tracer& tracer) {
+    if (enclosing != nullptr) {
+        tracer.visit(enclosing.get());
+    }
+    for (const auto& [name, value] : values) {
+        tracer.visit(value);
+    }
+    for (const Value& value : slots) {
+        tracer.visit(value);
+    }
+}
+
+void Environment::clear() {
+    values.clear();
+    slots.clear();
+    enclosing.reset();
+}
+
+size_t Environment::byteSize() const {
+    // Each map entry is a node holding the pair plus a next pointer and hash.
+    return sizeof(Environment) + slots.capacity() * sizeof(Value) +
+        values.size() * (2 * sizeof(Value) + 2 * sizeof(void*)) +
+        values.bucket_count() * sizeof(void*);
 }
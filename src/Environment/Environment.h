@@ -7,22 +7,53 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
-#include "Token/Token.h"
+#include <vector>
+#include "Value/Value.h"
 
-class Environment {
+// Closures keep their defining Environment alive and are usually stored in
+// it, so Environments are Traceable and shared_ptr-owned: references() is
+// the shared_ptr use count.
+class Environment final : public Traceable, public std::enable_shared_from_this<Environment> {
 public:
     Environment() : enclosing(nullptr) {}
-    explicit Environment(const std::shared_ptr<Environment> &enclosing)
-        : enclosing(enclosing) {}
+    explicit Environment(const std::shared_ptr<Environment> &enclosing, const size_t slotCount = 0)
+        : enclosing(enclosing), slots(slotCount) {}
 
-    void define(const std::string& name, const Literal& value);
-    Literal get(const Token& name);
-    void assign(const Token& name, const Literal &value);
+    // Name-based bindings, used for globals and natives. `name` is an
+    // interned String; `line` is reported if the name is undefined.
+    void define(const std::string& name, const Value& value);
+    void define(const char* name, const Value& value) { define(std::string(name), value); }
+    void define(const Value& name, const Value& value);
+    Value get(const Value& name, int line);
+    void assign(const Value& name, const Value &value, int line);
+
+    // Returns a pointer to this scope's own binding (not the enclosing chain),
+    // or nullptr. The pointer stays valid for the lifetime of the Environment.
+    Value* lookup(const std::string& name);
+
+    // Slot-based bindings for locals, addressed by the Resolver's (depth, slot).
+    Value& at(int depth, int slot);
+    void defineAt(const int slot, const Value& value) { slots[slot] = value; }
 
     std::shared_ptr<Environment> enclosing;
+
+    size_t references() const override { return static_cast<size_t>(weak_from_this().use_count()); }
+    void trace(Tracer& tracer) override;
+    void clear() override;
+    std::shared_ptr<void> hold() override { return shared_from_this(); }
+    size_t byteSize() const override;
+
 private:
-    std::unordered_map<std::string, Literal> values;
+    // Names are interned Strings, so lookups hash and compare pointers.
+    struct NameHash {
+        size_t operator()(const Value& name) const {
+            return std::hash<const Object*>{}(name.asObject());
+        }
+    };
+
+    std::unordered_map<Value, Value, NameHash> values;
+    std::vector<Value> slots;
 };
 
 
-#endif //CIPR_ENVIRONMENT_H
\ No newline at end of file
+#endif //CIPR_ENVIRONMENT_H
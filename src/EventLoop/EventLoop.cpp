@@ -0,0 +1,178 @@
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sys/resource.h>
+#include "Interpreter/Callable.h"
+
+bool EventLoop::open() {
+    if (poller.ready())
+        return true;
+    if (!poller.open())
+        return false;
+
+    raiseFileLimit();
+    for (const auto& [fd, watch] : watches) {
+        update(fd, watch);
+    }
+    return true;
+}
+
+size_t EventLoop::raiseFileLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return 1024;
+    if (limit.rlim_cur < limit.rlim_max) {
+        const rlim_t previous = limit.rlim_cur;
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limit) != 0)
+            limit.rlim_cur = previous;
+    }
+    return static_cast<size_t>(limit.rlim_cur);
+}
+
+bool EventLoop::update(const int fd, const Watch& watch) {
+    return poller.set(fd, static_cast<uint64_t>(fd), !watch.onReadable.isNull(), !watch.onWritable.isNull());
+}
+
+bool EventLoop::watch(const int fd, const bool writable, const Value& callback) {
+    const auto it = watches.find(fd);
+    if (it == watches.end() && callback.isNull())
+        return true;
+    if (!open())
+        return false;
+
+    Watch next = it == watches.end() ? Watch{} : it->second;
+    (writable ? next.onWritable : next.onReadable) = callback;
+    if (!update(fd, next))
+        return false;
+
+    if (next.onReadable.isNull() && next.onWritable.isNull()) {
+        watches.erase(it);
+    } else {
+        watches[fd] = std::move(next);
+    }
+    return true;
+}
+
+void EventLoop::forget(const int fd) {
+    const auto it = watches.find(fd);
+    if (it == watches.end())
+        return;
+    if (poller.ready()) {
+        poller.remove(fd);
+    }
+    watches.erase(it);
+}
+
+uint64_t EventLoop::addTimer(const double ms, const Value& callback, const bool repeat) {
+    const uint64_t id = nextTimer++;
+    const double delay = std::max(ms, 0.0);
+    const double at = now() + delay;
+    timers.emplace(id, Timer{callback, repeat ? delay : -1, at});
+    deadlines.push({at, id});
+    return id;
+}
+
+bool EventLoop::cancel(const uint64_t id) {
+    if (timers.erase(id) == 0)
+        return false;
+
+    if (deadlines.size() > 2 * timers.size() + 64) {
+        std::vector<Deadline> live;
+        live.reserve(timers.size());
+        for (const auto& [timer, entry] : timers) {
+            live.push_back({entry.at, timer});
+        }
+        deadlines = decltype(deadlines)(std::greater<>(), std::move(live));
+    }
+    return true;
+}
+
+bool EventLoop::run(Interpreter& interpreter) {
+    if (running)
+        return false;
+    if (!open())
+        return false;
+
+    struct Running {
+        bool& flag;
+        explicit Running(bool& flag) : flag(flag) { flag = true; }
+        ~Running() { flag = false; }
+    } guard(running);
+    stopped = false;
+
+    std::vector<Poller::Event> events;
+    while (!stopped && (!watches.empty() || !timers.empty())) {
+        if (!poller.wait(timeout(), 256, events))
+            return true;
+
+        for (size_t i = 0; i < events.size() && !stopped; i++) {
+            dispatch(interpreter, events[i]);
+        }
+        if (!stopped) {
+            fireTimers(interpreter);
+        }
+    }
+    return true;
+}
+
+void EventLoop::dispatch(Interpreter& interpreter, const Poller::Event& event) {
+    // Hangups and errors go to whichever callback is watching, so it finds
+    // out through recv_nb or send_nb.
+    const int fd = static_cast<int>(event.key);
+    auto it = watches.find(fd);
+    if (it != watches.end() && !it->second.onReadable.isNull() && (event.readable || event.failed)) {
+        invoke(interpreter, it->second.onReadable, {static_cast<double>(fd)});
+        // The callback may have closed the fd or changed its watches.
+        it = watches.find(fd);
+    }
+    if (it != watches.end() && !it->second.onWritable.isNull() && (event.writable || event.failed)) {
+        invoke(interpreter, it->second.onWritable, {static_cast<double>(fd)});
+    }
+}
+
+void EventLoop::fireTimers(Interpreter& interpreter) {
+    // Only timers already due fire, so a zero interval cannot spin here.
+    const double current = now();
+    std::vector<uint64_t> due;
+    while (!deadlines.empty() && deadlines.top().at <= current) {
+        due.push_back(deadlines.top().id);
+        deadlines.pop();
+    }
+
+    for (const uint64_t id : due) {
+        const auto it = timers.find(id);
+        if (it == timers.end())
+            continue;
+        const Value callback = it->second.callback;
+        if (it->second.interval >= 0) {
+            it->second.at = current + it->second.interval;
+            deadlines.push({it->second.at, id});
+        } else {
+            timers.erase(it);
+        }
+        invoke(interpreter, callback, {});
+        if (stopped)
+            return;
+    }
+}
+
+int EventLoop::timeout() const {
+    if (timers.empty() || deadlines.empty())
+        return -1;
+    const double wait = deadlines.top().at - now();
+    return wait <= 0 ? 0 : static_cast<int>(std::ceil(wait));
+}
+
+double EventLoop::now() {
+    const auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+void EventLoop::invoke(Interpreter& interpreter, const Value& callback, std::vector<Value> arguments) {
+    // Holds the callback, which may remove its own watch or timer.
+    const Value held = callback;
+    held.asCallable()->call(interpreter, Arguments(arguments));
+}
@@ -0,0 +1,91 @@
+#ifndef CIPR_EVENTLOOP_H
+#define CIPR_EVENTLOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "EventLoop/Poller.h"
+#include "Value/Value.h"
+
+class Interpreter;
+
+// Readiness callbacks and timers for run_loop(), over one Poller.
+// Watches are level-triggered: a callback keeps being called while its fd
+// stays readable or writable, so it need not drain the socket in one go.
+// Callbacks are held as Values, which keeps them alive until removed.
+class EventLoop {
+public:
+    EventLoop() = default;
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Calls `callback(fd)` whenever `fd` is readable (or writable), in place
+    // of any earlier callback. A null callback stops watching. Returns false
+    // if the Poller refuses the fd.
+    bool watch(int fd, bool writable, const Value& callback);
+    // Drops both callbacks for `fd`; close() calls this before closing it.
+    void forget(int fd);
+
+    // Calls `callback()` after `ms`, and every `ms` after that if `repeat`.
+    // Returns the timer's id, for cancel().
+    uint64_t addTimer(double ms, const Value& callback, bool repeat);
+    bool cancel(uint64_t id);
+
+    // Dispatches callbacks until nothing is watched or scheduled, or stop()
+    // is called. Returns false if the loop is already running.
+    bool run(Interpreter& interpreter);
+    void stop() { stopped = true; }
+    bool isRunning() const { return running; }
+
+    // Raises the soft limit on open descriptors to the hard one, and returns
+    // the new soft limit. The default of 1024 is the first thing a process
+    // juggling thousands of sockets runs into.
+    static size_t raiseFileLimit();
+
+private:
+    struct Watch {
+        Value onReadable;
+        Value onWritable;
+    };
+
+    struct Timer {
+        Value callback;
+        // Negative for a one-shot timer.
+        double interval;
+        double at;
+    };
+
+    struct Deadline {
+        double at;
+        uint64_t id;
+        bool operator>(const Deadline& other) const {
+            return at != other.at ? at > other.at : id > other.id;
+        }
+    };
+
+    // A forked child (the daemon's) opens its own and registers the
+    // watches it inherited again.
+    Poller poller;
+    std::unordered_map<int, Watch> watches;
+    std::unordered_map<uint64_t, Timer> timers;
+    // Cancelled timers stay queued and are skipped when they come due, until
+    // they outnumber the live ones and the queue is rebuilt.
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines;
+    uint64_t nextTimer = 1;
+    bool running = false;
+    bool stopped = false;
+
+    bool open();
+    bool update(int fd, const Watch& watch);
+    void dispatch(Interpreter& interpreter, const Poller::Event& event);
+    void fireTimers(Interpreter& interpreter);
+    // Milliseconds the Poller may block for: -1 when no timer is pending.
+    int timeout() const;
+
+    static double now();
+    static void invoke(Interpreter& interpreter, const Value& callback, std::vector<Value> arguments);
+};
+
+#endif //CIPR_EVENTLOOP_H
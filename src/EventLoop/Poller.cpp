@@ -0,0 +1,138 @@
+#include "Poller.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+
+Poller::~Poller() {
+    if (ready()) {
+        close(epollFd);
+    }
+}
+
+bool Poller::ready() const {
+    return epollFd != -1 && owner == getpid();
+}
+
+bool Poller::open() {
+    // Closing an inherited instance only drops this process's reference.
+    if (epollFd != -1) {
+        close(epollFd);
+    }
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    owner = getpid();
+    return epollFd != -1;
+}
+
+bool Poller::set(const int fd, const uint64_t key, const bool readable, const bool writable) {
+    if (!readable && !writable) {
+        remove(fd);
+        return true;
+    }
+    epoll_event event{};
+    event.data.u64 = key;
+    if (readable) event.events |= EPOLLIN | EPOLLRDHUP;
+    if (writable) event.events |= EPOLLOUT;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0)
+        return true;
+    return errno == EEXIST && epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void Poller::remove(const int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+bool Poller::wait(const int timeout, const size_t limit, std::vector<Event>& events) {
+    events.clear();
+    buffer.resize(std::max<size_t>(limit, 1));
+    const int count = epoll_wait(epollFd, buffer.data(), static_cast<int>(buffer.size()), timeout);
+    if (count == -1)
+        return errno == EINTR;
+    for (int i = 0; i < count; i++) {
+        const uint32_t flags = buffer[i].events;
+        events.push_back({buffer[i].data.u64, (flags & (EPOLLIN | EPOLLRDHUP)) != 0,
+                          (flags & EPOLLOUT) != 0, (flags & (EPOLLHUP | EPOLLERR)) != 0});
+    }
+    return true;
+}
+
+#else
+
+Poller::~Poller() = default;
+
+bool Poller::ready() const {
+    return opened && owner == getpid();
+}
+
+bool Poller::open() {
+    fds.clear();
+    keys.clear();
+    slots.clear();
+    cursor = 0;
+    opened = true;
+    owner = getpid();
+    return true;
+}
+
+bool Poller::set(const int fd, const uint64_t key, const bool readable, const bool writable) {
+    if (!readable && !writable) {
+        remove(fd);
+        return true;
+    }
+    short interests = 0;
+    if (readable) interests |= POLLIN;
+    if (writable) interests |= POLLOUT;
+    if (const auto it = slots.find(fd); it != slots.end()) {
+        fds[it->second].events = interests;
+        keys[it->second] = key;
+        return true;
+    }
+    // poll() would skip a negative fd and flag a closed one on every call.
+    if (fd < 0 || fcntl(fd, F_GETFD) == -1)
+        return false;
+    slots[fd] = fds.size();
+    fds.push_back({fd, interests, 0});
+    keys.push_back(key);
+    return true;
+}
+
+void Poller::remove(const int fd) {
+    const auto it = slots.find(fd);
+    if (it == slots.end())
+        return;
+    // The last entry takes the freed slot.
+    const size_t slot = it->second;
+    slots.erase(it);
+    if (slot + 1 != fds.size()) {
+        fds[slot] = fds.back();
+        keys[slot] = keys.back();
+        slots[fds[slot].fd] = slot;
+    }
+    fds.pop_back();
+    keys.pop_back();
+}
+
+bool Poller::wait(const int timeout, const size_t limit, std::vector<Event>& events) {
+    events.clear();
+    const int count = poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout);
+    if (count == -1)
+        return errno == EINTR;
+    if (count == 0 || fds.empty())
+        return true;
+
+    cursor %= fds.size();
+    for (size_t i = 0; i < fds.size() && events.size() < std::max<size_t>(limit, 1); i++) {
+        const size_t slot = (cursor + i) % fds.size();
+        const short flags = fds[slot].revents;
+        if (flags == 0) continue;
+        events.push_back({keys[slot], (flags & POLLIN) != 0, (flags & POLLOUT) != 0,
+                          (flags & (POLLHUP | POLLERR | POLLNVAL)) != 0});
+    }
+    cursor++;
+    return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef CIPR_POLLER_H
+#define CIPR_POLLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+// Level-triggered readiness for a set of fds: epoll on Linux, poll()
+// elsewhere. Each fd is registered with a key that comes back with its
+// events. An instance belongs to the process that opened it; a forked child
+// must open() its own, since an epoll instance is shared across fork.
+class Poller {
+public:
+    struct Event {
+        uint64_t key;
+        bool readable;
+        bool writable;
+        // Hung up or errored; whoever watches the fd finds out by using it.
+        bool failed;
+    };
+
+    Poller() = default;
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+    ~Poller();
+
+    // Whether this process has an instance open.
+    bool ready() const;
+    // Starts afresh with nothing registered, dropping an inherited instance.
+    bool open();
+
+    // Registers `fd` for the given interests, or changes them; with neither
+    // it is removed. Returns false if the backend refuses the fd, as epoll
+    // does a regular file.
+    bool set(int fd, uint64_t key, bool readable, bool writable);
+    // Unregisters `fd`, which must be done before it is closed.
+    void remove(int fd);
+
+    // Waits up to `timeout` ms (-1 for no limit) and fills `events` with at
+    // most `limit` ready fds. Returns false on an error other than EINTR.
+    bool wait(int timeout, size_t limit, std::vector<Event>& events);
+
+private:
+    pid_t owner = 0;
+#ifdef __linux__
+    int epollFd = -1;
+    std::vector<epoll_event> buffer;
+#else
+    bool opened = false;
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> keys;
+    // Position of each fd in fds and keys.
+    std::unordered_map<int, size_t> slots;
+    // Where the next scan starts, so a full batch does not always go to the
+    // same fds.
+    size_t cursor = 0;
+#endif
+};
+
+#endif //CIPR_POLLER_H
@@ -0,0 +1,61 @@
+#ifndef CIPR_SOCKET_H
+#define CIPR_SOCKET_H
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Socket calls that Linux makes in one step and other systems in several.
+
+// Sets FD_CLOEXEC, and O_NONBLOCK if `nonBlocking`, on a new descriptor.
+inline bool configureSocket(const int fd, const bool nonBlocking) {
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+        return false;
+    if (!nonBlocking)
+        return true;
+    const int flags = fcntl(fd, F_GETFL);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+// socket() that is closed on exec, and non-blocking if asked.
+inline int openSocket(const int domain, const int type, const bool nonBlocking) {
+#ifdef __linux__
+    return socket(domain, type | SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0), 0);
+#else
+    const int fd = socket(domain, type, 0);
+    if (fd != -1 && !configureSocket(fd, nonBlocking)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#endif
+}
+
+// accept() with the same guarantees as openSocket().
+inline int acceptSocket(const int server, const bool nonBlocking) {
+#ifdef __linux__
+    return accept4(server, nullptr, nullptr, SOCK_CLOEXEC | (nonBlocking ? SOCK_NONBLOCK : 0));
+#else
+    const int fd = accept(server, nullptr, nullptr);
+    if (fd != -1 && !configureSocket(fd, nonBlocking)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#endif
+}
+
+// send() that reports a peer which hung up as EPIPE rather than raising
+// SIGPIPE. Without MSG_NOSIGNAL the socket itself is told to.
+inline ssize_t sendQuietly(const int fd, const void* data, const size_t size, const int flags) {
+#ifdef MSG_NOSIGNAL
+    return send(fd, data, size, flags | MSG_NOSIGNAL);
+#else
+    constexpr int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    return send(fd, data, size, flags);
+#endif
+}
+
+#endif //CIPR_SOCKET_H
@@ -0,0 +1,197 @@
+#include "HttpClient.h"
+
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "EventLoop/Socket.h"
+
+namespace {
+    bool sendAll(const int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t n = sendQuietly(fd, data.data() + sent, data.size() - sent, 0);
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+}
+
+HttpClient::~HttpClient() {
+    closeAll();
+}
+
+void HttpClient::closeAll() {
+    for (auto& [key, host] : hosts) {
+        for (const int fd : host.idle) close(fd);
+    }
+    hosts.clear();
+}
+
+bool HttpClient::request(const std::string& method, const std::string& url,
+                         const std::vector<HttpParser::Header>& headers, const std::string* body,
+                         const HttpParser::Sink& sink, Response& response) {
+    if (owner != getpid()) {
+        closeAll();
+        owner = getpid();
+    }
+
+    std::string rest = url.compare(0, 7, "http://") == 0 ? url.substr(7) : url;
+    const size_t slash = rest.find('/');
+    std::string host = slash == std::string::npos ? rest : rest.substr(0, slash);
+    const std::string path = slash == std::string::npos ? "/" : rest.substr(slash);
+
+    std::string port = "80";
+    std::string authority = host;
+    if (const size_t colon = host.find(':'); colon != std::string::npos) {
+        port = host.substr(colon + 1);
+        host = host.substr(0, colon);
+    }
+
+    bool hasHost = false;
+    bool hasType = false;
+    std::string fields;
+    for (const auto& [name, value] : headers) {
+        // Line breaks would let a value smuggle in headers of its own.
+        if (name.empty() || name.find_first_of(":\r\n") != std::string::npos ||
+            value.find_first_of("\r\n") != std::string::npos)
+            return false;
+        // The client frames the request itself.
+        if (strcasecmp(name.c_str(), "Content-Length") == 0 || strcasecmp(name.c_str(), "Transfer-Encoding") == 0)
+            continue;
+        hasHost = hasHost || strcasecmp(name.c_str(), "Host") == 0;
+        hasType = hasType || strcasecmp(name.c_str(), "Content-Type") == 0;
+        fields += name + ": " + value + "\r\n";
+    }
+
+    std::string message = method + " " + path + " HTTP/1.1\r\n";
+    if (!hasHost) message += "Host: " + authority + "\r\n";
+    message += fields;
+    if (body) {
+        message += "Content-Length: " + std::to_string(body->size()) + "\r\n";
+        if (!hasType) message += "Content-Type: text/plain\r\n";
+        message += "\r\n";
+        message += *body;
+    } else {
+        message += "\r\n";
+    }
+
+    const std::string key = host + ":" + port;
+    while (true) {
+        // Looked up afresh each time, and not held past the sink: a sink
+        // that runs script code may make requests that drop this entry.
+        Host* entry = resolve(host, port);
+        if (!entry)
+            return false;
+
+        const bool pooled = !entry->idle.empty();
+        int fd;
+        if (pooled) {
+            fd = entry->idle.back();
+            entry->idle.pop_back();
+        } else if ((fd = connectTo(*entry)) == -1) {
+            // Look the host up again next time; its address may have moved.
+            hosts.erase(key);
+            return false;
+        }
+
+        HttpParser parser(sink, method == "HEAD");
+        bool reusable = false;
+        bool empty = true;
+        bool complete;
+        try {
+            complete = sendAll(fd, message) && readResponse(fd, parser, reusable, empty);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+
+        if (complete) {
+            response.status = parser.status();
+            response.reason = parser.reason();
+            response.headers = parser.headers();
+            response.size = parser.bodySize();
+            if (const auto it = hosts.find(key); reusable && it != hosts.end()) {
+                release(it->second, fd);
+            } else {
+                close(fd);
+            }
+            return true;
+        }
+        close(fd);
+
+        // A pooled connection the server has since closed fails without an
+        // answer; so do the others idle as long, so retry on a new one.
+        if (!pooled || !empty)
+            return false;
+        if (const auto it = hosts.find(key); it != hosts.end()) {
+            for (const int idle : it->second.idle) close(idle);
+            it->second.idle.clear();
+        }
+    }
+}
+
+HttpClient::Host* HttpClient::resolve(const std::string& host, const std::string& port) {
+    const std::string key = host + ":" + port;
+    if (const auto it = hosts.find(key); it != hosts.end())
+        return &it->second;
+
+    addrinfo hints{}, *res;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
+        return nullptr;
+
+    Host& entry = hosts[key];
+    std::memcpy(&entry.address, res->ai_addr, sizeof(entry.address));
+    freeaddrinfo(res);
+    return &entry;
+}
+
+int HttpClient::connectTo(const Host& host) const {
+    const int fd = openSocket(AF_INET, SOCK_STREAM, false);
+    if (fd == -1)
+        return -1;
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&host.address), sizeof(host.address)) == -1) {
+        close(fd);
+        return -1;
+    }
+    constexpr int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+void HttpClient::release(Host& host, const int fd) {
+    if (host.idle.size() >= POOL_SIZE) {
+        close(fd);
+        return;
+    }
+    host.idle.push_back(fd);
+}
+
+bool HttpClient::readResponse(const int fd, HttpParser& parser, bool& reusable, bool& empty) {
+    char chunk[65536];
+    empty = true;
+    while (!parser.done() && !parser.failed()) {
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) {
+            parser.finish();
+            break;
+        }
+        empty = false;
+        // Bytes past the end of the response mean its framing was not what
+        // it claimed, so the connection cannot be trusted with another.
+        if (parser.feed(chunk, static_cast<size_t>(n)) < static_cast<size_t>(n)) {
+            reusable = false;
+            return parser.done();
+        }
+    }
+    reusable = parser.keepAlive();
+    return parser.done();
+}
@@ -0,0 +1,64 @@
+#ifndef CIPR_HTTPCLIENT_H
+#define CIPR_HTTPCLIENT_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/types.h>
+#include "Http/HttpParser.h"
+
+// HTTP/1.1 client behind the http_ natives. Connections are kept open and
+// reused per host:port, and each host is resolved once. Responses go through
+// an HttpParser as they arrive, so the body is never held twice and a
+// streamed one is never held at all.
+class HttpClient {
+public:
+    HttpClient() = default;
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+    ~HttpClient();
+
+    struct Response {
+        int status = 0;
+        std::string reason;
+        std::vector<HttpParser::Header> headers;
+        // Body bytes passed to the sink.
+        size_t size = 0;
+    };
+
+    // Sends `method` to an http:// (or scheme-less) URL with `headers` and,
+    // unless null, `body`, and passes the response body to `sink`. Returns
+    // false if the host cannot be reached, a header or the response is
+    // malformed, or the sink aborts.
+    bool request(const std::string& method, const std::string& url, const std::vector<HttpParser::Header>& headers,
+                 const std::string* body, const HttpParser::Sink& sink, Response& response);
+
+    // Idle connections kept per host.
+    static constexpr size_t POOL_SIZE = 8;
+
+private:
+    struct Host {
+        sockaddr_in address{};
+        std::vector<int> idle;
+    };
+
+    std::unordered_map<std::string, Host> hosts;
+    // The process the pooled sockets belong to. A forked child (a daemon
+    // client or serve() worker) starts its own pool: two processes reading
+    // one connection would interleave responses.
+    pid_t owner = 0;
+
+    Host* resolve(const std::string& host, const std::string& port);
+    int connectTo(const Host& host) const;
+    void release(Host& host, int fd);
+    void closeAll();
+
+    // Reads one response from `fd` through `parser`. `empty` tells whether
+    // the connection closed before sending anything, as a pooled one the
+    // server has timed out does.
+    static bool readResponse(int fd, HttpParser& parser, bool& reusable, bool& empty);
+};
+
+#endif //CIPR_HTTPCLIENT_H
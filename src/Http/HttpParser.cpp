@@ -0,0 +1,203 @@
+#include "HttpParser.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <strings.h>
+
+namespace {
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+        return text;
+    }
+
+    bool equalsIgnoreCase(const std::string_view a, const char* b) {
+        return a.size() == std::strlen(b) && strncasecmp(a.data(), b, a.size()) == 0;
+    }
+
+    // Whether the comma-separated header value `value` lists `token`.
+    bool hasToken(std::string_view value, const char* token) {
+        while (!value.empty()) {
+            const size_t comma = value.find(',');
+            if (equalsIgnoreCase(trim(value.substr(0, comma)), token)) return true;
+            if (comma == std::string_view::npos) break;
+            value.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    // Parses hex or decimal digits up to the first non-digit. Returns false
+    // if there are none or the number overflows.
+    bool parseSize(const std::string_view text, const int base, size_t& value) {
+        value = 0;
+        size_t digits = 0;
+        for (const char c : text) {
+            int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (base == 16 && c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (base == 16 && c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else break;
+            if (value > (SIZE_MAX - digit) / base) return false;
+            value = value * base + digit;
+            digits++;
+        }
+        return digits > 0;
+    }
+}
+
+HttpParser::HttpParser(Sink sink, const bool bodyless) : sink(std::move(sink)), bodyless(bodyless) {}
+
+size_t HttpParser::feed(const char* data, const size_t size) {
+    size_t i = 0;
+    while (i < size && state != State::DONE && state != State::FAILED) {
+        switch (state) {
+            case State::BODY:
+            case State::CHUNK: {
+                const size_t take = std::min(remaining, size - i);
+                if (!emit(data + i, take)) break;
+                i += take;
+                remaining -= take;
+                if (remaining == 0) {
+                    state = state == State::BODY ? State::DONE : State::CHUNK_END;
+                }
+                break;
+            }
+            case State::UNTIL_EOF:
+                if (emit(data + i, size - i)) i = size;
+                break;
+            default: {
+                const auto* newline = static_cast<const char*>(std::memchr(data + i, '\n', size - i));
+                const size_t take = newline ? static_cast<size_t>(newline - (data + i)) + 1 : size - i;
+                line.append(data + i, take);
+                i += take;
+                if (line.size() > MAX_LINE) {
+                    state = State::FAILED;
+                    break;
+                }
+                if (!newline) break;
+
+                std::string_view text(line);
+                text.remove_suffix(1);
+                if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+                onLine(text);
+                line.clear();
+                break;
+            }
+        }
+    }
+    return i;
+}
+
+void HttpParser::finish() {
+    if (state == State::UNTIL_EOF) {
+        state = State::DONE;
+    } else if (state != State::DONE) {
+        state = State::FAILED;
+    }
+}
+
+void HttpParser::onLine(const std::string_view text) {
+    switch (state) {
+        case State::STATUS:
+            // A stray empty line may trail the previous response.
+            if (!text.empty() && !onStatus(text)) state = State::FAILED;
+            break;
+        case State::HEADER:
+            if (text.empty()) {
+                endHeaders();
+            } else if (!onHeader(text)) {
+                state = State::FAILED;
+            }
+            break;
+        case State::CHUNK_SIZE:
+            // Chunk extensions after a ';' are ignored.
+            if (!parseSize(trim(text), 16, remaining)) {
+                state = State::FAILED;
+            } else {
+                state = remaining == 0 ? State::TRAILER : State::CHUNK;
+            }
+            break;
+        case State::CHUNK_END:
+            state = text.empty() ? State::CHUNK_SIZE : State::FAILED;
+            break;
+        case State::TRAILER:
+            // Trailer fields are read past; an empty line ends them.
+            if (text.empty()) state = State::DONE;
+            break;
+        default:
+            break;
+    }
+}
+
+bool HttpParser::onStatus(const std::string_view text) {
+    // HTTP/1.1 200 OK
+    if (text.size() < 12 || text.compare(0, 7, "HTTP/1.") != 0 || text[8] != ' ')
+        return false;
+    size_t parsed;
+    if (!parseSize(text.substr(9, 3), 10, parsed) || parsed < 100 || parsed > 999 ||
+        (text.size() > 12 && text[12] != ' '))
+        return false;
+
+    code = static_cast<int>(parsed);
+    phrase = text.size() > 13 ? std::string(text.substr(13)) : std::string();
+    fields.clear();
+    persistent = text[7] != '0';
+    chunked = false;
+    sized = false;
+    state = State::HEADER;
+    return true;
+}
+
+bool HttpParser::onHeader(const std::string_view text) {
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos || colon == 0)
+        return false;
+    const std::string_view name = text.substr(0, colon);
+    const std::string_view value = trim(text.substr(colon + 1));
+
+    if (equalsIgnoreCase(name, "Content-Length")) {
+        size_t length;
+        if (!parseSize(value, 10, length) || (sized && length != remaining))
+            return false;
+        sized = true;
+        remaining = length;
+    } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+        chunked = hasToken(value, "chunked");
+    } else if (equalsIgnoreCase(name, "Connection")) {
+        if (hasToken(value, "close")) persistent = false;
+        else if (hasToken(value, "keep-alive")) persistent = true;
+    }
+    fields.emplace_back(std::string(name), std::string(value));
+    return true;
+}
+
+void HttpParser::endHeaders() {
+    if (code < 200) {
+        // An interim response; the real one follows.
+        state = State::STATUS;
+        return;
+    }
+    if (bodyless || code == 204 || code == 304) {
+        state = State::DONE;
+    } else if (chunked) {
+        // Chunked framing wins over a Content-Length sent alongside it.
+        state = State::CHUNK_SIZE;
+    } else if (sized) {
+        state = remaining == 0 ? State::DONE : State::BODY;
+    } else {
+        state = State::UNTIL_EOF;
+        persistent = false;
+    }
+}
+
+bool HttpParser::emit(const char* data, const size_t size) {
+    if (size == 0)
+        return true;
+    received += size;
+    if (!sink(data, size)) {
+        state = State::FAILED;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef CIPR_HTTPPARSER_H
+#define CIPR_HTTPPARSER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Incremental HTTP/1.1 response parser. Bytes are fed in as they arrive, in
+// pieces of any size, and body bytes go straight out to a sink, so the only
+// thing buffered is the status, header or chunk-size line in progress.
+// Bodies are framed by Content-Length, chunked encoding or, failing both,
+// the connection closing.
+class HttpParser {
+public:
+    using Header = std::pair<std::string, std::string>;
+    // Receives the body, de-chunked, a piece at a time. Returning false
+    // aborts the parse.
+    using Sink = std::function<bool(const char* data, size_t size)>;
+
+    // `bodyless` is for the response to a HEAD request, which has headers
+    // describing a body that is not sent.
+    explicit HttpParser(Sink sink, bool bodyless = false);
+
+    // Consumes bytes from `data`. Returns how many, which is fewer than
+    // `size` only once the response is complete or the parse has failed.
+    size_t feed(const char* data, size_t size);
+    // Tells the parser the peer closed the connection, which completes a
+    // response framed by it and fails any other that is unfinished.
+    void finish();
+
+    bool done() const { return state == State::DONE; }
+    bool failed() const { return state == State::FAILED; }
+    // Whether the connection can carry another request once this is done.
+    bool keepAlive() const { return done() && persistent; }
+
+    int status() const { return code; }
+    const std::string& reason() const { return phrase; }
+    // In the order received, names as sent. 1xx interim responses are
+    // skipped, along with their headers.
+    const std::vector<Header>& headers() const { return fields; }
+    // Body bytes passed to the sink so far.
+    size_t bodySize() const { return received; }
+
+    // Longest status, header or chunk-size line accepted.
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+private:
+    enum class State {
+        STATUS,
+        HEADER,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK,
+        CHUNK_END,
+        TRAILER,
+        UNTIL_EOF,
+        DONE,
+        FAILED,
+    };
+
+    Sink sink;
+    bool bodyless;
+    State state = State::STATUS;
+    std::string line;
+
+    int code = 0;
+    std::string phrase;
+    std::vector<Header> fields;
+    bool persistent = true;
+    bool chunked = false;
+    bool sized = false;
+    // Bytes left in the body or the current chunk.
+    size_t remaining = 0;
+    size_t received = 0;
+
+    void onLine(std::string_view text);
+    bool onStatus(std::string_view text);
+    bool onHeader(std::string_view text);
+    void endHeaders();
+    bool emit(const char* data, size_t size);
+};
+
+#endif //CIPR_HTTPPARSER_H
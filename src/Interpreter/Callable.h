@@ -3,18 +3,47 @@
 
 #include <vector>
 #include <string>
-#include "Token/Token.h"
+#include "Value/Value.h"
 
 class Interpreter;
 
-struct Callable {
-    virtual ~Callable() = default;
+// A call's arguments, left in place on the caller's value stack. Elements
+// are reached through the owning vector rather than a raw pointer, since a
+// re-entrant call may grow it while the arguments are still in use.
+class Arguments {
+public:
+    Arguments(const std::vector<Value>& values, const size_t first, const size_t count)
+        : values(&values), first(first), count(count) {}
+    explicit Arguments(const std::vector<Value>& values)
+        : Arguments(values, 0, values.size()) {}
+
+    const Value& operator[](const size_t i) const { return (*values)[first + i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    const std::vector<Value>* values;
+    size_t first;
+    size_t count;
+};
+
+struct Callable : Object {
+    Callable() : Object(ObjectType::CALLABLE) {}
 
     virtual int arity() = 0;
 
-    virtual Literal call(Interpreter& interpreter, std::vector<Literal> arguments) = 0;
+    virtual Value call(Interpreter& interpreter, Arguments arguments) = 0;
 
     virtual std::string toString() = 0;
 };
 
+inline Callable* Value::asCallable() const {
+    return static_cast<Callable*>(asObject());
+}
+
+// Whether `value` can be called back with `count` arguments.
+inline bool isCallback(const Value& value, const int count) {
+    return value.isCallable() && value.asCallable()->arity() == count;
+}
+
 #endif //CIPR_CALLABLE_H
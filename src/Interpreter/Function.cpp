@@ -1,36 +1,99 @@
 #include "Function.h"
 #include "Interpreter.h"
-#include "Common/Return.h"
 #include "AST/Node.h"
 #include "Environment/Environment.h"
 
-Function::Function(int declarationIdx, Arena& arena, std::shared_ptr<Environment> closure)
-    : declarationIdx(declarationIdx), arena(arena), closure(std::move(closure)) {}
+#include <algorithm>
+
+Function::Function(const int declarationIdx, std::shared_ptr<Arena> arena, std::shared_ptr<Environment> closure)
+    : declarationIdx(declarationIdx), arena(std::move(arena)), closure(std::move(closure)) {}
 
 int Function::arity() {
-    const Node& decl = arena.get(declarationIdx);
-    return static_cast<int>(decl.children.size()) - 1;
+    return static_cast<int>(arena->get(declarationIdx).children().size()) - 1;
+}
+
+Value Function::call(Interpreter& interpreter, const Arguments arguments) {
+    Collector::instance().maybeCollect();
+
+    Arena* const previousArena = interpreter.arena;
+    const size_t previousBase = interpreter.pushFrame(arena->get(declarationIdx).frameSize());
+    std::shared_ptr<Environment> environment = bind(interpreter, arguments);
+
+    // A tail call hands back the next function instead of recursing, and
+    // runs in this same frame. `callee` keeps that function alive.
+    Value callee;
+    Function* function = this;
+    Value result;
+
+    while (true) {
+        interpreter.arena = function->arena.get();
+        const Node decl = function->arena->get(function->declarationIdx);
+        const Node body = function->arena->get(decl.children().back());
+        const Completion completion = interpreter.executeBlock(body.children(), environment);
+
+        if (completion == Completion::RETURN) {
+            result = std::move(interpreter.returnValue);
+            interpreter.returnValue = Value();
+        }
+        if (completion != Completion::TAIL_CALL)
+            break;
+
+        callee = std::move(interpreter.tailCallee);
+        interpreter.tailCallee = Value();
+        function = static_cast<Function*>(callee.asCallable());
+        environment = function->rebind(interpreter);
+    }
+
+    interpreter.popFrame(previousBase);
+    interpreter.arena = previousArena;
+    return result;
 }
 
-Literal Function::call(Interpreter& interpreter, const std::vector<Literal> arguments) {
-    const auto environment = std::make_shared<Environment>(closure);
-    const Node& decl = arena.get(declarationIdx);
+std::shared_ptr<Environment> Function::bind(Interpreter& interpreter, const Arguments arguments) const {
+    const Node decl = arena->get(declarationIdx);
+    const Node body = arena->get(decl.children().back());
+
+    // Only a body that declares a function of its own needs a heap scope.
+    auto environment = body.slotCount() > 0
+        ? std::make_shared<Environment>(closure, body.slotCount())
+        : closure;
 
     for (size_t i = 0; i < arguments.size(); ++i) {
-        const Node& param = arena.get(decl.children[i]);
-        environment->define(param.op.lexeme, arguments[i]);
+        const Node param = arena->get(decl.child(i));
+        if (param.depth() >= 0) {
+            environment->defineAt(param.slot(), arguments[i]);
+        } else {
+            interpreter.stack[interpreter.frameBase + param.slot()] = arguments[i];
+        }
     }
+    return environment;
+}
 
-    const Node& body = arena.get(decl.children.back());
-    try {
-        interpreter.executeBlock(body.children, environment);
-    } catch (const Return& returnValue) {
-        return returnValue.value;
+std::shared_ptr<Environment> Function::rebind(Interpreter& interpreter) const {
+    const Node decl = arena->get(declarationIdx);
+    std::vector<Value>& stack = interpreter.stack;
+    const size_t base = interpreter.frameBase;
+    const size_t count = decl.children().size() - 1;
+
+    // Slide the pending arguments down to the start of the frame, dropping
+    // the previous call's locals, then size the frame for this function.
+    // Parameters bind to slots at or below their argument's position, so
+    // bind() never overwrites an argument it has yet to read.
+    for (size_t i = 0; i < count; ++i) {
+        stack[base + i] = std::move(stack[interpreter.tailArguments + i]);
     }
+    stack.resize(base + count);
+    stack.resize(base + std::max(count, static_cast<size_t>(decl.frameSize())));
+
+    return bind(interpreter, Arguments(stack, base, count));
+}
 
-    return std::monostate{};
+void Function::trace(Tracer& tracer) {
+    if (closure != nullptr) {
+        tracer.visit(closure.get());
+    }
 }
 
 std::string Function::toString() {
-    return "<fn " + arena.get(declarationIdx).op.lexeme + ">";
+    return "<fn " + arena->get(declarationIdx).lexeme() + ">";
 }
@@ -9,20 +9,29 @@
 class Interpreter;
 class Environment;
 class Arena;
-struct Node;
 
-class Function final : public Callable {
+class Function final : public Callable, public Traceable {
 public:
-    Function(int declarationIdx, Arena& arena, std::shared_ptr<Environment> closure);
+    Function(int declarationIdx, std::shared_ptr<Arena> arena, std::shared_ptr<Environment> closure);
 
     int arity() override;
-    Literal call(Interpreter& interpreter, std::vector<Literal> arguments) override;
+    Value call(Interpreter& interpreter, Arguments arguments) override;
     std::string toString() override;
 
+    Traceable* traceable() override { return this; }
+    size_t references() const override { return refCount; }
+    void trace(Tracer& tracer) override;
+    void clear() override { closure.reset(); }
+    std::shared_ptr<void> hold() override { return std::make_shared<Value>(Value(this)); }
+    size_t byteSize() const override { return sizeof(Function); }
+
 private:
     int declarationIdx;
-    Arena& arena;
+    std::shared_ptr<Arena> arena;
     std::shared_ptr<Environment> closure;
+
+    std::shared_ptr<Environment> bind(Interpreter& interpreter, Arguments arguments) const;
+    std::shared_ptr<Environment> rebind(Interpreter& interpreter) const;
 };
 
 #endif //CIPR_FUNCTION_H
\ No newline at end of file
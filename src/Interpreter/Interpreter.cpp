@@ -6,28 +6,92 @@
 
 #include "Function.h"
 #include "Common/RuntimeError.h"
-#include "Common/Return.h"
+#include "Value/Map.h"
+#include "Core/Core.h"
 #include "Native/NativeRegistry.h"
+#include <cmath>
+#include <cstdint>
 
-Interpreter::Interpreter(Arena& arena) : arena(arena) {
+Interpreter::Interpreter(Core& core) : core(core) {
     globals = std::make_shared<Environment>();
     environment = globals;
     NativeRegistry::registerAll(globals);
 }
 
-void Interpreter::interpret(const int rootIndex) {
+Interpreter::~Interpreter() {
+    // Functions defined at the top level form cycles with the globals, so
+    // dropping our own references is not enough to free them.
+    stack.clear();
+    returnValue = Value();
+    tailCallee = Value();
+    environment.reset();
+    globals.reset();
+    Collector::instance().collect(true);
+}
+
+void Interpreter::interpret(Arena& region, const int rootIndex) {
+    Arena* const previousArena = arena;
+    arena = &region;
+    const std::shared_ptr<Environment> previous = environment;
+    const size_t previousBase = pushFrame(arena->get(rootIndex).frameSize());
+    const size_t rootBase = frameBase;
+
+    const auto restore = [&] {
+        popFrame(previousBase);
+        environment = previous;
+        arena = previousArena;
+    };
+
+    // An exception skips every frame and scope above this one. A ScriptExit,
+    // or whatever else the embedder catches, must leave them for the next
+    // script as they were.
     try {
         execute(rootIndex);
     } catch (const RuntimeError& error) {
-        std::cerr << "Runtime Error: " << error.what() << "\n[line " << error.token.line << "]" << std::endl;
+        core.runtimeError(error);
+        frameBase = rootBase;
+    } catch (...) {
+        frameBase = rootBase;
+        restore();
+        throw;
+    }
+
+    restore();
+}
+
+Value Interpreter::callRecovering(Callable& callee, const Arguments arguments) {
+    Arena* const previousArena = arena;
+    const std::shared_ptr<Environment> previous = environment;
+    const size_t previousBase = frameBase;
+    const size_t previousTop = stack.size();
+
+    try {
+        return callee.call(*this, arguments);
+    } catch (const RuntimeError&) {
+        stack.resize(previousTop);
+        frameBase = previousBase;
+        environment = previous;
+        arena = previousArena;
+        throw;
     }
 }
 
-void Interpreter::execute(const int index) {
-    switch (const Node& node = arena.get(index); node.type) {
+size_t Interpreter::pushFrame(const int size) {
+    const size_t previousBase = frameBase;
+    frameBase = stack.size();
+    stack.resize(frameBase + size);
+    return previousBase;
+}
+
+void Interpreter::popFrame(const size_t previousBase) {
+    stack.resize(frameBase);
+    frameBase = previousBase;
+}
+
+Completion Interpreter::execute(const int index) {
+    switch (const Node node = arena->get(index); node.type()) {
         case NodeType::STMT_LIST:
-            visitStmtList(node);
-            break;
+            return visitStmtList(node);
         case NodeType::STMT_VAR_DECL:
             visitVarDeclaration(node);
             break;
@@ -38,107 +102,158 @@ void Interpreter::execute(const int index) {
             visitExpressionStmt(node);
             break;
         case NodeType::STMT_BLOCK:
-            visitBlockStmt(node);
-            break;
+            return visitBlockStmt(node);
         case NodeType::STMT_IF:
-            visitIfStmt(node);
-            break;
+            return visitIfStmt(node);
         case NodeType::STMT_WHILE:
-            visitWhileStmt(node);
-            break;
+            return visitWhileStmt(node);
         case NodeType::STMT_FUNCTION:
             visitFunctionStmt(node, index);
             break;
         case NodeType::STMT_RETURN:
-            visitReturnStmt(node);
-            break;
+            return visitReturnStmt(node);
         default:
             evaluate(index);
             break;
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::executeBlock(const std::vector<int>& statements,
+Completion Interpreter::executeBlock(const Children statements,
     const std::shared_ptr<Environment> &env) {
 
+    // A RuntimeError leaves the environment to be restored by interpret()
+    // or callRecovering().
     const std::shared_ptr<Environment> previous = this->environment;
+    this->environment = env;
 
-    try {
-        this->environment = env;
-           for (const int index : statements) {
-               execute(index);
-             }
-    } catch (...) {
-        this->environment = previous;
-        throw;
+    Completion completion = Completion::NORMAL;
+    for (const int index : statements) {
+        completion = execute(index);
+        if (completion != Completion::NORMAL) break;
     }
 
     this->environment = previous;
+    return completion;
 }
 
-void Interpreter::visitBlockStmt(const Node& node) {
-    const auto blockEnv = std::make_shared<Environment>(environment);
+Completion Interpreter::visitBlockStmt(const Node& node) {
+    if (node.slotCount() == 0) {
+        // Nothing declared here is captured; its locals live in the frame.
+        for (const int index : node.children()) {
+            if (const Completion completion = execute(index); completion != Completion::NORMAL) {
+                return completion;
+            }
+        }
+        return Completion::NORMAL;
+    }
+
+    const auto blockEnv = std::make_shared<Environment>(environment, node.slotCount());
 
-    executeBlock(node.children, blockEnv);
+    return executeBlock(node.children(), blockEnv);
 }
 
-void Interpreter::visitWhileStmt(const Node& node) {
-    while (isTruthy(evaluate(node.children[0]))) {
-        execute(node.children[1]);
+Completion Interpreter::visitWhileStmt(const Node& node) {
+    while (isTruthy(evaluate(node.child(0)))) {
+        if (const Completion completion = execute(node.child(1)); completion != Completion::NORMAL) {
+            return completion;
+        }
+        Collector::instance().maybeCollect();
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::visitIfStmt(const Node& node) {
-    if (isTruthy(evaluate(node.children[0]))) {
-        execute(node.children[1]);
-    } else if (node.children[2] != -1) {
-        execute(node.children[2]);
+Completion Interpreter::visitIfStmt(const Node& node) {
+    if (isTruthy(evaluate(node.child(0)))) {
+        return execute(node.child(1));
     }
+    if (node.child(2) != -1) {
+        return execute(node.child(2));
+    }
+    return Completion::NORMAL;
 }
 
 void Interpreter::visitFunctionStmt(const Node& node, int index) {
-    auto function = std::make_shared<Function>(index, arena, environment);
-    environment->define(node.op.lexeme, function);
+    const Value function = Value::make<Function>(index, arena->shared_from_this(), environment);
+    if (node.depth() >= 0) {
+        environment->defineAt(node.slot(), function);
+    } else if (node.slot() >= 0) {
+        stack[frameBase + node.slot()] = function;
+    } else {
+        globals->define(node.name(), function);
+    }
 }
 
-void Interpreter::visitReturnStmt(const Node& node) {
-    Literal value = std::monostate{};
-    if (!node.children.empty() && node.children[0] != -1) {
-        value = evaluate(node.children[0]);
+Completion Interpreter::visitReturnStmt(const Node& node) {
+    returnValue = Value();
+    if (node.tailCall()) {
+        const Node call = arena->get(node.child(0));
+        Value callee = evaluate(call.child(0));
+        const size_t first = pushArguments(call);
+        Callable* function = checkCallable(call, callee);
+
+        // Script functions are left for the enclosing Function::call to run
+        // in place of the current one; anything else is called right here.
+        if (dynamic_cast<Function*>(function)) {
+            tailCallee = std::move(callee);
+            tailArguments = first;
+            return Completion::TAIL_CALL;
+        }
+        returnValue = function->call(*this, Arguments(stack, first, call.children().size() - 1));
+        stack.resize(first);
+        return Completion::RETURN;
+    }
+
+    if (!node.children().empty() && node.child(0) != -1) {
+        returnValue = evaluate(node.child(0));
     }
-    throw Return(value);
+    return Completion::RETURN;
 }
 
-void Interpreter::visitStmtList(const Node& node) {
-    for (const int childIndex : node.children) {
-        execute(childIndex);
+Completion Interpreter::visitStmtList(const Node& node) {
+    for (const int childIndex : node.children()) {
+        if (const Completion completion = execute(childIndex); completion != Completion::NORMAL) {
+            return completion;
+        }
     }
+    return Completion::NORMAL;
 }
 
 void Interpreter::visitEchoStmt(const Node& node) {
-    const Literal value = evaluate(node.children[0]);
-    std::cout << stringify(value) << std::endl;
+    const Value value = evaluate(node.child(0));
+    if (value.isString()) {
+        core.print(value.asString());
+    } else {
+        core.print(stringify(value));
+    }
 }
 
 void Interpreter::visitExpressionStmt(const Node& node) {
-    evaluate(node.children[0]);
+    evaluate(node.child(0));
 }
 
 void Interpreter::visitVarDeclaration(const Node &node) {
-    Literal value = std::monostate{};
+    Value value;
+
+    if (!node.children().empty() && node.child(0) != -1) {
+        value = evaluate(node.child(0));
+    }
 
-    if (!node.children.empty() && node.children[0] != -1) {
-        value = evaluate(node.children[0]);
+    if (node.depth() >= 0) {
+        environment->defineAt(node.slot(), value);
+    } else if (node.slot() >= 0) {
+        stack[frameBase + node.slot()] = std::move(value);
+    } else {
+        globals->define(node.name(), value);
     }
-    environment->define(node.op.lexeme, value);
 }
 
 
-Literal Interpreter::evaluate(const int index) {
+Value Interpreter::evaluate(const int index) {
     if (index == -1)
-        return std::monostate{};
+        return Value();
 
-    switch (const Node& node = arena.get(index); node.type) {
+    switch (Node node = arena->get(index); node.type()) {
         case NodeType::VAR_EXPR:
             return visitVarExpr(node);
         case NodeType::ASSIGN:
@@ -151,6 +266,10 @@ Literal Interpreter::evaluate(const int index) {
             return visitArrayExpr(node);
         case NodeType::INDEX_GET:
             return visitIndexGet(node);
+        case NodeType::INDEX_SET:
+            return visitIndexSet(node);
+        case NodeType::MAP:
+            return visitMapExpr(node);
         case NodeType::LITERAL:
             return visitLiteral(node);
         case NodeType::GROUPING:
@@ -159,214 +278,383 @@ Literal Interpreter::evaluate(const int index) {
             return visitUnary(node);
         case NodeType::BINARY:
             return visitBinary(node);
+        case NodeType::ADD_NUM:
+        case NodeType::SUBTRACT_NUM:
+        case NodeType::MULTIPLY_NUM:
+        case NodeType::DIVIDE_NUM:
+        case NodeType::LESS_NUM:
+        case NodeType::LESS_EQUAL_NUM:
+        case NodeType::GREATER_NUM:
+        case NodeType::GREATER_EQUAL_NUM:
+            return visitNumberBinary(node);
+        case NodeType::ADD_STR:
+            return visitStringAdd(node);
         default:
-            return std::monostate{};
+            return Value();
     }
 }
 
-Literal Interpreter::visitLogicalExpr(const Node &node) {
-    Literal left = evaluate(node.children[0]);
+Value Interpreter::visitLogicalExpr(const Node &node) {
+    Value left = evaluate(node.child(0));
 
-    if (node.op.type == OR) {
+    if (node.op() == OR) {
         if (isTruthy(left))
             return left;
     }
 
-    if (node.op.type == AND) {
+    if (node.op() == AND) {
         if (!isTruthy(left))
             return left;
     }
 
-    return evaluate(node.children[1]);
+    return evaluate(node.child(1));
 }
 
-Literal Interpreter::visitCallExpr(const Node& node) {
-    const Literal callee = evaluate(node.children[0]);
+Value Interpreter::visitCallExpr(const Node& node) {
+    const Value callee = evaluate(node.child(0));
+    const size_t first = pushArguments(node);
+    Callable* function = checkCallable(node, callee);
+
+    Value result = function->call(*this, Arguments(stack, first, node.children().size() - 1));
+    stack.resize(first);
+    return result;
+}
 
-    std::vector<Literal> arguments;
-    for (size_t i = 1; i < node.children.size(); i++) {
-        arguments.push_back(evaluate(node.children[i]));
+// Arguments are pushed above the current frame and popped once the call
+// returns; nested calls made while evaluating them leave the stack as they
+// found it. After a RuntimeError, interpret() or callRecovering() truncates
+// the stack instead.
+size_t Interpreter::pushArguments(const Node& call) {
+    const size_t first = stack.size();
+    for (size_t i = 1; i < call.children().size(); i++) {
+        stack.push_back(evaluate(call.child(i)));
     }
+    return first;
+}
 
-    if (!std::holds_alternative<std::shared_ptr<Callable>>(callee)) {
-        throw RuntimeError(node.op, "Can only call functions and classes.");
+Callable* Interpreter::checkCallable(const Node& call, const Value& callee) const {
+    if (!callee.isCallable()) {
+        throw RuntimeError(call.line(), "Can only call functions and classes.");
     }
 
-    const auto function = std::get<std::shared_ptr<Callable>>(callee);
+    Callable* function = callee.asCallable();
+    const size_t count = call.children().size() - 1;
 
-    if (arguments.size() != static_cast<size_t>(function->arity())) {
-        throw RuntimeError(node.op, "Expected " +
+    if (count != static_cast<size_t>(function->arity())) {
+        throw RuntimeError(call.line(), "Expected " +
             std::to_string(function->arity()) + " arguments but got " +
-            std::to_string(arguments.size()) + ".");
+            std::to_string(count) + ".");
     }
-
-    return function->call(*this, arguments);
+    return function;
 }
 
-Literal Interpreter::visitArrayExpr(const Node& node) {
-    auto list = std::make_shared<LiteralVector>();
-    for (const int childIdx : node.children) {
-        list->elements.push_back(evaluate(childIdx));
+Value Interpreter::visitArrayExpr(const Node& node) {
+    Value list = Value::make<LiteralVector>();
+    for (const int childIdx : node.children()) {
+        list.asArray()->elements.push_back(evaluate(childIdx));
     }
     return list;
 }
 
-Literal Interpreter::visitIndexGet(const Node& node) {
-    const Literal target = evaluate(node.children[0]);
-    const Literal index = evaluate(node.children[1]);
+Value Interpreter::visitMapExpr(const Node& node) {
+    Value map = Value::make<LiteralMap>();
+    map.asMap()->reserve(node.children().size() / 2);
+    for (size_t i = 0; i + 1 < node.children().size(); i += 2) {
+        const Value key = evaluate(node.child(i));
+        map.asMap()->set(key, evaluate(node.child(i + 1)));
+    }
+    return map;
+}
+
+Value Interpreter::visitIndexGet(const Node& node) {
+    const Value target = evaluate(node.child(0));
+    const Value index = evaluate(node.child(1));
 
-    if (!std::holds_alternative<std::shared_ptr<LiteralVector>>(target)) {
-        throw RuntimeError(node.op, "Only arrays can be indexed.");
+    // A missing key reads as null; has() tells the two apart.
+    if (target.isMap()) {
+        const Value* value = target.asMap()->find(index);
+        return value ? *value : Value();
     }
 
-    if (!std::holds_alternative<double>(index)) {
-        throw RuntimeError(node.op, "Index must be a number.");
+    return elementAt(node, target, index);
+}
+
+Value Interpreter::visitIndexSet(const Node& node) {
+    const Value target = evaluate(node.child(0));
+    const Value index = evaluate(node.child(1));
+    Value value = evaluate(node.child(2));
+
+    if (target.isMap()) {
+        target.asMap()->set(index, value);
+    } else {
+        elementAt(node, target, index) = value;
     }
+    return value;
+}
 
-    const auto list = std::get<std::shared_ptr<LiteralVector>>(target);
-    const int i = static_cast<int>(std::get<double>(index));
+Value& Interpreter::elementAt(const Node& node, const Value& target, const Value& index) {
+    if (!target.isArray()) {
+        throw RuntimeError(node.line(), "Only arrays and maps can be indexed.");
+    }
 
-    if (i < 0 || i >= list->elements.size()) {
-        throw RuntimeError(node.op, "Array index out of bounds.");
+    if (!index.isNumber()) {
+        throw RuntimeError(node.line(), "Index must be a number.");
+    }
+
+    const auto list = target.asArray();
+    const int i = static_cast<int>(index.asNumber());
+
+    if (i < 0 || i >= static_cast<int>(list->elements.size())) {
+        throw RuntimeError(node.line(), "Array index out of bounds.");
     }
 
     return list->elements[i];
 }
 
-Literal Interpreter::visitVarExpr(const Node &node) const {
-    return environment->get(node.op);
+Value Interpreter::visitVarExpr(const Node &node) const {
+    if (node.depth() >= 0) {
+        return environment->at(node.depth(), node.slot());
+    }
+    if (node.slot() >= 0) {
+        return stack[frameBase + node.slot()];
+    }
+    return globals->get(node.name(), node.line());
 }
 
-Literal Interpreter::visitAssignmentExpr(const Node &node) {
-    Literal value = evaluate(node.children[0]);
-    environment->assign(node.op, value);
+Value Interpreter::visitAssignmentExpr(const Node &node) {
+    Value value = evaluate(node.child(0));
+    if (node.depth() >= 0) {
+        environment->at(node.depth(), node.slot()) = value;
+    } else if (node.slot() >= 0) {
+        stack[frameBase + node.slot()] = value;
+    } else {
+        globals->assign(node.name(), value, node.line());
+    }
     return value;
 }
 
-Literal Interpreter::visitLiteral(const Node& node) {
-    return node.value;
+Value Interpreter::visitLiteral(const Node& node) {
+    return node.value();
 }
 
-Literal Interpreter::visitGrouping(const Node& node) {
-    return evaluate(node.children[0]);
+Value Interpreter::visitGrouping(const Node& node) {
+    return evaluate(node.child(0));
 }
 
-Literal Interpreter::visitUnary(const Node& node) {
-    const Literal right = evaluate(node.children[0]);
+Value Interpreter::visitUnary(const Node& node) {
+    const Value right = evaluate(node.child(0));
 
-    switch (node.op.type) {
+    switch (node.op()) {
         case MINUS:
-            checkNumberOperand(node.op, right);
-            return -std::get<double>(right);
+            checkNumberOperand(node.line(), right);
+            return -right.asNumber();
 
         case BANG:
             return !isTruthy(right);
 
         default:
-            return std::monostate{};
+            return Value();
     }
 }
 
-Literal Interpreter::visitBinary(const Node& node) {
-    const Literal left = evaluate(node.children[0]);
-    const Literal right = evaluate(node.children[1]);
+Value Interpreter::visitBinary(Node& node) {
+    const Value left = evaluate(node.child(0));
+    const Value right = evaluate(node.child(1));
+
+    quicken(node, left, right);
+    return binaryOperation(node, left, right);
+}
+
+// Fast path for nodes that have only seen numbers. A miss rewrites the node
+// back to BINARY and finishes this evaluation generically, since the
+// operands have already been evaluated and must not run twice.
+Value Interpreter::visitNumberBinary(Node& node) {
+    const Value left = evaluate(node.child(0));
+    const Value right = evaluate(node.child(1));
+
+    if (!left.isNumber() || !right.isNumber()) {
+        deoptimize(node);
+        return binaryOperation(node, left, right);
+    }
+
+    const double a = left.asNumber();
+    const double b = right.asNumber();
+
+    switch (node.type()) {
+        case NodeType::ADD_NUM: return a + b;
+        case NodeType::SUBTRACT_NUM: return a - b;
+        case NodeType::MULTIPLY_NUM: return a * b;
+        case NodeType::DIVIDE_NUM:
+            if (b == 0.0) {
+                throw RuntimeError(node.line(), "Division by zero.");
+            }
+            return a / b;
+        case NodeType::LESS_NUM: return a < b;
+        case NodeType::LESS_EQUAL_NUM: return a <= b;
+        case NodeType::GREATER_NUM: return a > b;
+        case NodeType::GREATER_EQUAL_NUM: return a >= b;
+        default: return Value();
+    }
+}
 
-    switch (node.op.type) {
+Value Interpreter::visitStringAdd(Node& node) {
+    const Value left = evaluate(node.child(0));
+    const Value right = evaluate(node.child(1));
+
+    if (!left.isString() || !right.isString()) {
+        deoptimize(node);
+        return binaryOperation(node, left, right);
+    }
+
+    const std::string& a = left.asString();
+    const std::string& b = right.asString();
+    std::string result;
+    result.reserve(a.size() + b.size());
+    result += a;
+    result += b;
+    return result;
+}
+
+Value Interpreter::binaryOperation(const Node& node, const Value& left, const Value& right) {
+    switch (node.op()) {
         case MINUS:
-            checkNumberOperands(node.op, left, right);
-            return std::get<double>(left) - std::get<double>(right);
+            checkNumberOperands(node.line(), left, right);
+            return left.asNumber() - right.asNumber();
         case SLASH:
-            checkNumberOperands(node.op, left, right);
-            if (std::get<double>(right) == 0.0) {
-                throw RuntimeError(node.op, "Division by zero.");
+            checkNumberOperands(node.line(), left, right);
+            if (right.asNumber() == 0.0) {
+                throw RuntimeError(node.line(), "Division by zero.");
             }
-            return std::get<double>(left) / std::get<double>(right);
+            return left.asNumber() / right.asNumber();
         case STAR:
-            checkNumberOperands(node.op, left, right);
-            return std::get<double>(left) * std::get<double>(right);
+            checkNumberOperands(node.line(), left, right);
+            return left.asNumber() * right.asNumber();
 
         case PLUS:
-            if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
-                return std::get<double>(left) + std::get<double>(right);
+            if (left.isNumber() && right.isNumber()) {
+                return left.asNumber() + right.asNumber();
             }
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return stringify(left) + stringify(right);
+            if (left.isString() || right.isString()) {
+                return concatenate(left, right);
             }
 
-            throw RuntimeError(node.op, "Operands must be two numbers or two strings.");
+            throw RuntimeError(node.line(), "Operands must be two numbers or two strings.");
 
         case GREATER:
-            checkNumberOperands(node.op, left, right);
-            return std::get<double>(left) > std::get<double>(right);
+            checkNumberOperands(node.line(), left, right);
+            return left.asNumber() > right.asNumber();
         case GREATER_EQUAL:
-            checkNumberOperands(node.op, left, right);
-            return std::get<double>(left) >= std::get<double>(right);
+            checkNumberOperands(node.line(), left, right);
+            return left.asNumber() >= right.asNumber();
         case LESS:
-            checkNumberOperands(node.op, left, right);
-            return std::get<double>(left) < std::get<double>(right);
+            checkNumberOperands(node.line(), left, right);
+            return left.asNumber() < right.asNumber();
         case LESS_EQUAL:
-            checkNumberOperands(node.op, left, right);
-            return std::get<double>(left) <= std::get<double>(right);
+            checkNumberOperands(node.line(), left, right);
+            return left.asNumber() <= right.asNumber();
 
         case BANG_EQUAL: return !isEqual(left, right);
         case EQUAL_EQUAL: return isEqual(left, right);
 
-        default: return std::monostate{};
+        default: return Value();
+    }
+}
+
+void Interpreter::quicken(Node& node, const Value& left, const Value& right) {
+    static constexpr int MAX_DEOPTS = 4;
+    if (node.deopts() >= MAX_DEOPTS)
+        return;
+
+    if (left.isNumber() && right.isNumber()) {
+        switch (node.op()) {
+            case PLUS: node.setType(NodeType::ADD_NUM); break;
+            case MINUS: node.setType(NodeType::SUBTRACT_NUM); break;
+            case STAR: node.setType(NodeType::MULTIPLY_NUM); break;
+            case SLASH: node.setType(NodeType::DIVIDE_NUM); break;
+            case LESS: node.setType(NodeType::LESS_NUM); break;
+            case LESS_EQUAL: node.setType(NodeType::LESS_EQUAL_NUM); break;
+            case GREATER: node.setType(NodeType::GREATER_NUM); break;
+            case GREATER_EQUAL: node.setType(NodeType::GREATER_EQUAL_NUM); break;
+            default: break;
+        }
+    } else if (node.op() == PLUS && left.isString() && right.isString()) {
+        node.setType(NodeType::ADD_STR);
     }
 }
 
-bool Interpreter::isTruthy(const Literal& value) {
-    if (std::holds_alternative<std::monostate>(value))
+void Interpreter::deoptimize(Node& node) {
+    node.setType(NodeType::BINARY);
+    node.addDeopt();
+}
+
+bool Interpreter::isTruthy(const Value& value) {
+    if (value.isNull())
         return false;
 
-    if (std::holds_alternative<bool>(value))
-        return std::get<bool>(value);
+    if (value.isBool())
+        return value.asBool();
 
-    if (std::holds_alternative<double>(value)) {
-        return std::get<double>(value) != 0.0;
+    if (value.isNumber()) {
+        return value.asNumber() != 0.0;
     }
 
     return true;
 }
 
-void Interpreter::checkNumberOperand(const Token& op, const Literal& operand) {
-    if (std::holds_alternative<double>(operand))
+void Interpreter::checkNumberOperand(const int line, const Value& operand) {
+    if (operand.isNumber())
         return;
-    throw RuntimeError(op, "Operand must be a number.");
+    throw RuntimeError(line, "Operand must be a number.");
 }
 
-void Interpreter::checkNumberOperands(const Token& op, const Literal& left, const Literal& right) {
-    if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right))
+void Interpreter::checkNumberOperands(const int line, const Value& left, const Value& right) {
+    if (left.isNumber() && right.isNumber())
         return;
-    throw RuntimeError(op, "Operands must be numbers.");
+    throw RuntimeError(line, "Operands must be numbers.");
 }
 
-bool Interpreter::isEqual(const Literal& a, const Literal& b) {
-    if (a.index() != b.index())
-        return false;
+bool Interpreter::isEqual(const Value& a, const Value& b) {
     return a == b;
 }
 
-std::string Interpreter::stringify(const Literal& value) {
-    if (std::holds_alternative<std::monostate>(value)) return "null";
-    if (std::holds_alternative<bool>(value)) return std::get<bool>(value) ? "true" : "false";
+Value Interpreter::concatenate(const Value& left, const Value& right) {
+    // String operands are appended as they are; only others go through stringify.
+    std::string result = left.isString() ? left.asString() : stringify(left);
+    if (right.isString()) {
+        result += right.asString();
+    } else {
+        result += stringify(right);
+    }
+    return result;
+}
 
-    if (std::holds_alternative<double>(value)) {
-        std::string text = std::to_string(std::get<double>(value));
+std::string Interpreter::stringify(const Value& value) {
+    if (value.isNull()) return "null";
+    if (value.isBool()) return value.asBool() ? "true" : "false";
+
+    if (value.isNumber()) {
+        // Whole numbers, the common case for counters and ids, skip the
+        // printf formatting; -0 keeps its sign below.
+        const double number = value.asNumber();
+        if (std::abs(number) < 1e15 && number == static_cast<double>(static_cast<int64_t>(number)) &&
+            (number != 0 || !std::signbit(number))) {
+            return std::to_string(static_cast<int64_t>(number));
+        }
+        std::string text = std::to_string(number);
         text.erase(text.find_last_not_of('0') + 1, std::string::npos);
         if (text.back() == '.') text.pop_back();
         return text;
     }
 
-    if (std::holds_alternative<std::string>(value)) return std::get<std::string>(value);
+    if (value.isString()) return value.asString();
 
-    if (std::holds_alternative<std::shared_ptr<Callable>>(value)) {
-        return std::get<std::shared_ptr<Callable>>(value)->toString();
+    if (value.isCallable()) {
+        return value.asCallable()->toString();
     }
 
-    if (std::holds_alternative<std::shared_ptr<LiteralVector>>(value)) {
+    if (value.isArray()) {
         std::string result = "[";
-        const auto list = std::get<std::shared_ptr<LiteralVector>>(value);
+        const auto list = value.asArray();
         for (size_t i = 0; i < list->elements.size(); ++i) {
             result += stringify(list->elements[i]);
             if (i < list->elements.size() - 1) result += ", ";
@@ -375,5 +663,16 @@ std::string Interpreter::stringify(const Literal& value) {
         return result;
     }
 
+    if (value.isMap()) {
+        std::string result = "{";
+        for (const LiteralMap::Entry& entry : value.asMap()->entries()) {
+            if (!entry.live) continue;
+            if (result.size() > 1) result += ", ";
+            result += stringify(entry.key) + ": " + stringify(entry.value);
+        }
+        result += "}";
+        return result;
+    }
+
     return "unknown";
 }
\ No newline at end of file
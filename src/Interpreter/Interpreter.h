@@ -10,51 +10,101 @@
 #include "Callable.h"
 #include <iostream>
 
+class Core;
+
+// How a statement finished. Anything but NORMAL unwinds enclosing statements
+// until the construct that handles it: a RETURN stops at Function::call, as
+// does a TAIL_CALL, which Function::call then runs in the same frame.
+enum class Completion {
+    NORMAL,
+    RETURN,
+    TAIL_CALL,
+};
+
 class Interpreter {
     friend class Function;
+    friend class VM;
+    friend class Optimizer;
 public:
-    explicit Interpreter(Arena& arena);
+    explicit Interpreter(Core& core);
+    ~Interpreter();
+
+    void interpret(Arena& region, int rootIndex);
+    Core& getCore() const { return core; }
+    Environment& getGlobals() const { return *globals; }
+
+    // Calls `callee` for native code that goes on after a RuntimeError, as
+    // a serve() worker does. If one escapes, the frame stack, scope and
+    // region are put back as they were, which interpret() otherwise does,
+    // and it is rethrown.
+    Value callRecovering(Callable& callee, Arguments arguments);
 
-    void interpret(int rootIndex);
-    Arena& getArena() const { return arena; }
+    // The text echo prints for `value`.
+    static std::string stringify(const Value& value);
 
 private:
-    Arena& arena;
+    // Region of the code running now; Function::call switches it.
+    Arena* arena = nullptr;
+    Core& core;
     std::shared_ptr<Environment> globals;
     std::shared_ptr<Environment> environment;
 
-    Literal evaluate(int index);
-    void execute(int index);
-    void executeBlock(const std::vector<int>& statements,
+    // Locals of scopes no closure captures, one frame per call.
+    std::vector<Value> stack;
+    size_t frameBase = 0;
+
+    // Value of the RETURN completion currently unwinding.
+    Value returnValue;
+    // Callee of the TAIL_CALL completion currently unwinding; its arguments
+    // sit on the stack from tailArguments up.
+    Value tailCallee;
+    size_t tailArguments = 0;
+
+    size_t pushFrame(int size);
+    void popFrame(size_t previousBase);
+
+    Value evaluate(int index);
+    Completion execute(int index);
+    Completion executeBlock(Children statements,
         const std::shared_ptr<Environment> &env);
 
-    static Literal visitLiteral(const Node& node);
-    Literal visitUnary(const Node& node);
-    Literal visitBinary(const Node& node);
-    Literal visitGrouping(const Node& node);
-    Literal visitVarExpr(const Node& node) const;
-    Literal visitAssignmentExpr(const Node& node);
-    Literal visitLogicalExpr(const Node& node);
-    Literal visitCallExpr(const Node& node);
-    Literal visitIndexGet(const Node& node);
-    Literal visitArrayExpr(const Node& node);
-
-    void visitBlockStmt(const Node& node);
+    static Value visitLiteral(const Node& node);
+    Value visitUnary(const Node& node);
+    Value visitBinary(Node& node);
+    Value visitNumberBinary(Node& node);
+    Value visitStringAdd(Node& node);
+    Value binaryOperation(const Node& node, const Value& left, const Value& right);
+    static void quicken(Node& node, const Value& left, const Value& right);
+    static void deoptimize(Node& node);
+    Value visitGrouping(const Node& node);
+    Value visitVarExpr(const Node& node) const;
+    Value visitAssignmentExpr(const Node& node);
+    Value visitLogicalExpr(const Node& node);
+    Value visitCallExpr(const Node& node);
+    size_t pushArguments(const Node& call);
+    Callable* checkCallable(const Node& call, const Value& callee) const;
+    Value visitIndexGet(const Node& node);
+    Value visitIndexSet(const Node& node);
+    static Value& elementAt(const Node& node, const Value& target, const Value& index);
+    Value visitMapExpr(const Node& node);
+    Value visitArrayExpr(const Node& node);
+
+    Completion visitBlockStmt(const Node& node);
     void visitFunctionStmt(const Node& node, int index);
-    void visitReturnStmt(const Node& node);
-    void visitWhileStmt(const Node& node);
-    void visitIfStmt(const Node& node);
+    Completion visitReturnStmt(const Node& node);
+    Completion visitWhileStmt(const Node& node);
+    Completion visitIfStmt(const Node& node);
     void visitEchoStmt(const Node& node);
     void visitExpressionStmt(const Node& node);
-    void visitStmtList(const Node& node);
+    Completion visitStmtList(const Node& node);
     void visitVarDeclaration(const Node& node);
 
 
-    static bool isTruthy(const Literal& value);
-    static bool isEqual(const Literal& a, const Literal& b);
-    static void checkNumberOperand(const Token& op, const Literal& operand);
-    static void checkNumberOperands(const Token& op, const Literal& left, const Literal& right);
-    static std::string stringify(const Literal& value);
+    static bool isTruthy(const Value& value);
+    static bool isEqual(const Value& a, const Value& b);
+    static void checkNumberOperand(int line, const Value& operand);
+    static void checkNumberOperands(int line, const Value& left, const Value& right);
+    static Value concatenate(const Value& left, const Value& right);
 };
 
 #endif //CIPR_INTERPRETER_H
\ No newline at end of file
@@ -3,8 +3,8 @@
 
 #include "Interpreter/Interpreter.h"
 #include "Interpreter/Callable.h"
-#include "Scanner/Scanner.h"
-#include "Parser/Parser.h"
+#include "Core/Core.h"
+#include "Common/ScriptExit.h"
 #include <ctime>
 #include <cstdio>
 #include <memory>
@@ -18,13 +18,15 @@
 #include <sstream>
 #include <filesystem>
 #include <random>
+#include <algorithm>
+#include <cmath>
 
 struct NativeTime final : Callable {
     int arity() override {
         return 0;
     }
 
-    Literal call(Interpreter&, std::vector<Literal>) override {
+    Value call(Interpreter&, Arguments) override {
         const auto now = std::chrono::system_clock::now();
         const auto duration = now.time_since_epoch();
         return std::chrono::duration<double>(duration).count();
@@ -40,10 +42,10 @@ struct NativeRun final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-            return std::monostate{};
-        const auto cmd = std::get<std::string>(args[0]);
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
+            return Value();
+        const std::string& cmd = args[0].asString();
         std::array<char, 128> buf{};
         std::string res;
         const std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
@@ -65,14 +67,14 @@ struct NativeEnv final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-            return std::monostate{};
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
+            return Value();
 
-        const char* val = std::getenv(std::get<std::string>(args[0]).c_str());
+        const char* val = std::getenv(args[0].asString().c_str());
         if (val)
             return std::string(val);
-        return std::monostate{};
+        return Value();
     }
 
     std::string toString() override {
@@ -85,12 +87,12 @@ struct NativeCwd final : Callable {
         return 0;
     }
 
-    Literal call(Interpreter&, std::vector<Literal>) override {
+    Value call(Interpreter&, Arguments) override {
         char cwd[PATH_MAX];
         if (getcwd(cwd, sizeof(cwd)) != nullptr) {
             return std::string(cwd);
         }
-        return std::monostate{};
+        return Value();
     }
 
     std::string toString() override {
@@ -103,10 +105,10 @@ struct NativeCd final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
             return false;
-        const std::string path = std::get<std::string>(args[0]);
+        const std::string& path = args[0].asString();
         return chdir(path.c_str()) == 0;
     }
 
@@ -115,44 +117,69 @@ struct NativeCd final : Callable {
     }
 };
 
+// include() and reload(), which runs the file even if it has not changed.
 struct NativeInclude final : Callable {
+    const bool reload;
+
+    explicit NativeInclude(const bool reload = false) : reload(reload) {}
+
     int arity() override {
         return 1;
     }
 
-    Literal call(Interpreter& interpreter, std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isString())
             return false;
-        auto filename = std::get<std::string>(args[0]);
-        
-        // 1. Check Local Path
-        std::string final_path = filename;
-        std::ifstream file(final_path);
-
-        // 2. Check Global Library Path (~/.cipr/libs/)
-        if (!file.is_open()) {
-            if (const char* home = std::getenv("HOME")) {
-                final_path = std::string(home) + "/.cipr/libs/" + filename;
-                file.open(final_path);
-            }
-        }
+        // Route through Core so the file runs on the same engine as its caller.
+        return interpreter.getCore().include(args[0].asString(), reload);
+    }
 
-        if (!file.is_open())
-            return false;
+    std::string toString() override {
+        return reload ? "<native fn reload>" : "<native fn include>";
+    }
+};
 
-        std::stringstream buf;
-        buf << file.rdbuf();
-        
-        Scanner scanner(buf.str());
-        auto tokens = scanner.scanTokens();
-        Parser parser(tokens, interpreter.getArena());
-        int root = parser.parse();
-        interpreter.interpret(root);
-        return true;
+struct NativeModuleStats final : Callable {
+    int arity() override {
+        return 0;
+    }
+
+    Value call(Interpreter& interpreter, Arguments) override {
+        const Core& core = interpreter.getCore();
+        Value list = Value::make<LiteralVector>();
+        auto& elements = list.asArray()->elements;
+        elements.emplace_back(static_cast<double>(core.moduleStats().hits));
+        elements.emplace_back(static_cast<double>(core.moduleStats().misses));
+        elements.emplace_back(static_cast<double>(core.getModules().size()));
+        return list;
     }
 
     std::string toString() override {
-        return "<native fn include>";
+        return "<native fn module_stats>";
+    }
+};
+
+struct NativeModules final : Callable {
+    int arity() override {
+        return 0;
+    }
+
+    Value call(Interpreter& interpreter, Arguments) override {
+        Value list = Value::make<LiteralVector>();
+        for (const auto& [path, module] : interpreter.getCore().getModules()) {
+            Value names = Value::make<LiteralVector>();
+            names.asArray()->elements = module.names;
+
+            Value entry = Value::make<LiteralVector>();
+            entry.asArray()->elements.emplace_back(path);
+            entry.asArray()->elements.push_back(std::move(names));
+            list.asArray()->elements.push_back(std::move(entry));
+        }
+        return list;
+    }
+
+    std::string toString() override {
+        return "<native fn modules>";
     }
 };
 
@@ -161,11 +188,11 @@ struct NativeRand final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber())
             return 0.0;
 
-        const int max = static_cast<int>(std::get<double>(args[0]));
+        const int max = static_cast<int>(args[0].asNumber());
 
         if (max <= 0)
             return 0.0;
@@ -187,13 +214,13 @@ struct NativeSleep final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]))
-            return std::monostate{};
-        const int ms = static_cast<int>(std::get<double>(args[0]));
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber())
+            return Value();
+        const int ms = static_cast<int>(args[0].asNumber());
         std::this_thread::sleep_for(std::chrono::milliseconds(ms));
 
-        return std::monostate{};
+        return Value();
     }
 
         std::string toString() override {
@@ -206,13 +233,13 @@ struct NativeExit final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
+    Value call(Interpreter&, Arguments args) override {
         int code = 0;
 
-        if (std::holds_alternative<double>(args[0])) {
-            code = static_cast<int>(std::get<double>(args[0]));
+        if (args[0].isNumber()) {
+            code = static_cast<int>(args[0].asNumber());
         }
-        std::exit(code);
+        throw ScriptExit{code};
     }
 
     std::string toString() override {
@@ -220,4 +247,67 @@ struct NativeExit final : Callable {
     }
 };
 
-#endif
\ No newline at end of file
+// [collections, full_collections, freed_objects, total_pause_ms,
+//  max_pause_ms, live_bytes, tracked_objects]
+struct NativeGcStats final : Callable {
+    int arity() override {
+        return 0;
+    }
+
+    Value call(Interpreter&, Arguments) override {
+        const Collector& collector = Collector::instance();
+        const Collector::Stats& stats = collector.stats();
+
+        Value list = Value::make<LiteralVector>();
+        auto& elements = list.asArray()->elements;
+        elements.emplace_back(static_cast<double>(stats.collections));
+        elements.emplace_back(static_cast<double>(stats.fullCollections));
+        elements.emplace_back(static_cast<double>(stats.freedObjects));
+        elements.emplace_back(stats.totalPauseMs);
+        elements.emplace_back(stats.maxPauseMs);
+        elements.emplace_back(static_cast<double>(stats.liveBytes));
+        elements.emplace_back(static_cast<double>(collector.trackedObjects()));
+        return list;
+    }
+
+    std::string toString() override {
+        return "<native fn gc_stats>";
+    }
+};
+
+struct NativeGcCollect final : Callable {
+    int arity() override {
+        return 0;
+    }
+
+    Value call(Interpreter&, Arguments) override {
+        return static_cast<double>(Collector::instance().collect(true));
+    }
+
+    std::string toString() override {
+        return "<native fn gc_collect>";
+    }
+};
+
+struct NativeGcTune final : Callable {
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        // NaN would slip through the collector's std::max clamps.
+        if (!args[0].isNumber() || !args[1].isNumber() ||
+            !std::isfinite(args[0].asNumber()) || !std::isfinite(args[1].asNumber()))
+            return false;
+        Collector& collector = Collector::instance();
+        collector.setYoungThreshold(static_cast<size_t>(std::clamp(args[0].asNumber(), 1.0, 1e15)));
+        collector.setGrowthFactor(args[1].asNumber());
+        return true;
+    }
+
+    std::string toString() override {
+        return "<native fn gc_tune>";
+    }
+};
+
+#endif
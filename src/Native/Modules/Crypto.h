@@ -102,10 +102,10 @@ struct NativeHex final : Callable {
       return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-          return std::monostate{};
-        const auto s = std::get<std::string>(args[0]);
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
+          return Value();
+        const std::string& s = args[0].asString();
         std::stringstream ss;
         for (const unsigned char c : s)
           ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(c);
@@ -122,10 +122,10 @@ struct NativeBase64Encode final : Callable {
       return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-          return std::monostate{};
-        const auto s = std::get<std::string>(args[0]);
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
+          return Value();
+        const std::string& s = args[0].asString();
         return base64_encode(reinterpret_cast<const unsigned char*>(s.c_str()), s.length());
     }
 
@@ -139,10 +139,10 @@ struct NativeBase64Decode final : Callable {
       return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-          return std::monostate{};
-        return base64_decode(std::get<std::string>(args[0]));
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
+          return Value();
+        return base64_decode(args[0].asString());
     }
 
   std::string toString() override {
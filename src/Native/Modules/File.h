@@ -12,10 +12,10 @@ struct NativeReadFile final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-            return std::monostate{};
-        std::ifstream file(std::get<std::string>(args[0]));
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString())
+            return Value();
+        std::ifstream file(args[0].asString());
         if (!file.is_open())
             return std::string("Error: Open failed");
         std::stringstream buf;
@@ -33,13 +33,13 @@ struct NativeWriteFile final : Callable {
         return 2;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString() || !args[1].isString())
             return false;
-        std::ofstream file(std::get<std::string>(args[0]));
+        std::ofstream file(args[0].asString());
         if (!file.is_open())
             return false;
-        file << std::get<std::string>(args[1]);
+        file << args[1].asString();
         return true;
     }
     std::string toString() override { return "<native fn write_file>"; }
@@ -50,18 +50,18 @@ struct NativeLs final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
+    Value call(Interpreter&, Arguments args) override {
         std::string path = ".";
-        if (std::holds_alternative<std::string>(args[0])) {
-            path = std::get<std::string>(args[0]);
+        if (args[0].isString()) {
+            path = args[0].asString();
         }
-        auto list = std::make_shared<LiteralVector>();
+        Value list = Value::make<LiteralVector>();
         try {
             for (const auto& entry : std::filesystem::directory_iterator(path)) {
-                list->elements.emplace_back(entry.path().filename().string());
+                list.asArray()->elements.emplace_back(entry.path().filename().string());
             }
         } catch (...) {
-            return std::monostate{};
+            return Value();
         }
         return list;
     }
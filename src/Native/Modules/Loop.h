@@ -0,0 +1,273 @@
+#ifndef CIPR_NATIVE_LOOP_H
+#define CIPR_NATIVE_LOOP_H
+
+#include "Interpreter/Interpreter.h"
+#include "Interpreter/Callable.h"
+#include "Core/Core.h"
+#include "Common/ScriptExit.h"
+#include "EventLoop/Socket.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+// on_readable(fd, fn) and on_writable(fd, fn): fn(fd) runs from run_loop()
+// while fd is ready. Null stops watching.
+struct NativeOnReady final : Callable {
+    const bool writable;
+
+    explicit NativeOnReady(const bool writable) : writable(writable) {}
+
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isNumber() || !(args[1].isNull() || isCallback(args[1], 1)))
+            return false;
+        return interpreter.getCore().getLoop().watch(static_cast<int>(args[0].asNumber()), writable, args[1]);
+    }
+
+    std::string toString() override {
+        return writable ? "<native fn on_writable>" : "<native fn on_readable>";
+    }
+};
+
+// set_timeout(ms, fn) and set_interval(ms, fn): fn() runs from run_loop()
+// once after ms, or every ms. Returns the timer's id.
+struct NativeSetTimer final : Callable {
+    const bool repeat;
+
+    explicit NativeSetTimer(const bool repeat) : repeat(repeat) {}
+
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isNumber() || !isCallback(args[1], 0))
+            return -1.0;
+        return static_cast<double>(interpreter.getCore().getLoop().addTimer(args[0].asNumber(), args[1], repeat));
+    }
+
+    std::string toString() override {
+        return repeat ? "<native fn set_interval>" : "<native fn set_timeout>";
+    }
+};
+
+struct NativeClearTimer final : Callable {
+    int arity() override {
+        return 1;
+    }
+
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isNumber() || args[0].asNumber() < 1)
+            return false;
+        return interpreter.getCore().getLoop().cancel(static_cast<uint64_t>(args[0].asNumber()));
+    }
+
+    std::string toString() override {
+        return "<native fn clear_timer>";
+    }
+};
+
+struct NativeRunLoop final : Callable {
+    int arity() override {
+        return 0;
+    }
+
+    Value call(Interpreter& interpreter, Arguments) override {
+        return interpreter.getCore().getLoop().run(interpreter);
+    }
+
+    std::string toString() override {
+        return "<native fn run_loop>";
+    }
+};
+
+struct NativeStopLoop final : Callable {
+    int arity() override {
+        return 0;
+    }
+
+    Value call(Interpreter& interpreter, Arguments) override {
+        interpreter.getCore().getLoop().stop();
+        return Value();
+    }
+
+    std::string toString() override {
+        return "<native fn stop_loop>";
+    }
+};
+
+// Watches a serve() worker's listening socket. Accepts up to a batch of
+// pending connections per wakeup and passes each fd to the script's handler,
+// which owns it from then on. A handler that fails is reported and its
+// connection closed, so one bad request does not cost the server a worker.
+struct ServeAcceptor final : Callable {
+    static constexpr int BATCH = 64;
+    const Value handler;
+
+    explicit ServeAcceptor(Value handler) : handler(std::move(handler)) {}
+
+    int arity() override {
+        return 1;
+    }
+
+    Value call(Interpreter& interpreter, Arguments args) override {
+        const int server_fd = static_cast<int>(args[0].asNumber());
+        std::vector<Value> arguments(1);
+        for (int i = 0; i < BATCH; i++) {
+            const int fd = acceptSocket(server_fd, false);
+            if (fd == -1)
+                break;
+            arguments[0] = static_cast<double>(fd);
+            try {
+                interpreter.callRecovering(*handler.asCallable(), Arguments(arguments));
+            } catch (const RuntimeError& error) {
+                interpreter.getCore().runtimeError(error);
+                interpreter.getCore().getLoop().forget(fd);
+                close(fd);
+            }
+        }
+        return Value();
+    }
+
+    std::string toString() override {
+        return "<native fn serve_accept>";
+    }
+};
+
+// serve(port, fn, workers): forks `workers` processes (one per core if 0),
+// each with its own SO_REUSEPORT socket on `port`, so the kernel spreads
+// connections across them. Each worker runs the event loop on a copy of the
+// script's state and calls fn(fd) for every client. A runtime error in fn is
+// reported and closes that client's fd; the worker keeps serving. Returns
+// once every worker has exited: true if all stopped cleanly (stop_loop()),
+// false if the port cannot be bound or a worker failed, e.g. through an
+// error in another callback. Only Linux balances connections across the
+// workers and kills them if the parent is killed; elsewhere one worker may
+// take most connections, and workers can outlive a killed parent.
+struct NativeServe final : Callable {
+    int arity() override {
+        return 3;
+    }
+
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isNumber() || !isCallback(args[1], 1) || !args[2].isNumber())
+            return false;
+        // A worker would inherit a loop that is already running.
+        if (interpreter.getCore().getLoop().isRunning())
+            return false;
+
+        const int port = static_cast<int>(args[0].asNumber());
+        long workers = static_cast<long>(args[2].asNumber());
+        if (workers <= 0)
+            workers = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+        workers = std::min(workers, 1024L);
+
+        std::vector<int> sockets;
+        for (long i = 0; i < workers; i++) {
+            const int fd = bindReusePort(port);
+            if (fd == -1) {
+                for (const int open : sockets) close(open);
+                return false;
+            }
+            sockets.push_back(fd);
+        }
+
+        // Whatever is buffered would otherwise be written once per worker.
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+
+        [[maybe_unused]] const pid_t parent = getpid();
+        std::vector<pid_t> children;
+        for (size_t i = 0; i < sockets.size(); i++) {
+            const pid_t pid = fork();
+            if (pid == 0) {
+#ifdef __linux__
+                // Workers must not outlive a parent killed by a signal.
+                prctl(PR_SET_PDEATHSIG, SIGTERM);
+                if (getppid() != parent) _exit(1);
+#endif
+                std::signal(SIGCHLD, SIG_DFL);
+                std::signal(SIGPIPE, SIG_IGN);
+                for (size_t j = 0; j < sockets.size(); j++) {
+                    if (j != i) close(sockets[j]);
+                }
+                _exit(work(interpreter, sockets[i], args[1]));
+            }
+            if (pid == -1) {
+                for (const pid_t child : children) kill(child, SIGTERM);
+                break;
+            }
+            children.push_back(pid);
+        }
+        for (const int fd : sockets) close(fd);
+
+        bool clean = children.size() == sockets.size();
+        for (const pid_t child : children) {
+            int status = 0;
+            while (waitpid(child, &status, 0) == -1 && errno == EINTR) {}
+            clean = clean && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        return clean;
+    }
+
+    std::string toString() override {
+        return "<native fn serve>";
+    }
+
+private:
+    static int bindReusePort(const int port) {
+        const int fd = openSocket(AF_INET, SOCK_STREAM, true);
+        if (fd == -1) return -1;
+
+        constexpr int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port);
+
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Runs in the worker; returns its exit status.
+    static int work(Interpreter& interpreter, const int fd, const Value& handler) {
+        Core& core = interpreter.getCore();
+        int status = 0;
+        try {
+            EventLoop& loop = core.getLoop();
+            if (!loop.watch(fd, false, Value::make<ServeAcceptor>(handler)) || !loop.run(interpreter))
+                status = 1;
+        } catch (const RuntimeError& error) {
+            core.runtimeError(error);
+            status = 70;
+        } catch (const ScriptExit& exit) {
+            status = exit.code;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        return status;
+    }
+};
+
+#endif //CIPR_NATIVE_LOOP_H
@@ -0,0 +1,82 @@
+#ifndef CIPR_NATIVE_MAP_H
+#define CIPR_NATIVE_MAP_H
+
+#include "Interpreter/Callable.h"
+#include "Value/Map.h"
+
+struct NativeKeys final : Callable {
+    int arity() override {
+        return 1;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        Value res = Value::make<LiteralVector>();
+        if (!args[0].isMap())
+            return res;
+        const LiteralMap* map = args[0].asMap();
+        auto& elements = res.asArray()->elements;
+        elements.reserve(map->size());
+        for (const LiteralMap::Entry& entry : map->entries()) {
+            if (entry.live) elements.push_back(entry.key);
+        }
+        return res;
+    }
+
+    std::string toString() override {
+        return "<native fn keys>";
+    }
+};
+
+struct NativeValues final : Callable {
+    int arity() override {
+        return 1;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        Value res = Value::make<LiteralVector>();
+        if (!args[0].isMap())
+            return res;
+        const LiteralMap* map = args[0].asMap();
+        auto& elements = res.asArray()->elements;
+        elements.reserve(map->size());
+        for (const LiteralMap::Entry& entry : map->entries()) {
+            if (entry.live) elements.push_back(entry.value);
+        }
+        return res;
+    }
+
+    std::string toString() override {
+        return "<native fn values>";
+    }
+};
+
+struct NativeHas final : Callable {
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        return args[0].isMap() && args[0].asMap()->find(args[1]) != nullptr;
+    }
+
+    std::string toString() override {
+        return "<native fn has>";
+    }
+};
+
+// Returns whether the key was there.
+struct NativeRemove final : Callable {
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        return args[0].isMap() && args[0].asMap()->remove(args[1]);
+    }
+
+    std::string toString() override {
+        return "<native fn remove>";
+    }
+};
+
+#endif //CIPR_NATIVE_MAP_H
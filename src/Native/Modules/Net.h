@@ -1,7 +1,19 @@
 #ifndef CIPR_NATIVE_NET_H
 #define CIPR_NATIVE_NET_H
 
+#include "Interpreter/Interpreter.h"
 #include "Interpreter/Callable.h"
+#include "Core/Core.h"
+#include "EventLoop/Poller.h"
+#include "EventLoop/Socket.h"
+#include "Value/Map.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <cctype>
+#include <deque>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <unistd.h>
@@ -13,12 +25,12 @@ struct NativeConnect final : Callable {
         return 2;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<double>(args[1]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString() || !args[1].isNumber())
             return -1.0;
 
-        const auto host = std::get<std::string>(args[0]);
-        const std::string port = std::to_string(static_cast<int>(std::get<double>(args[1])));
+        const std::string& host = args[0].asString();
+        const std::string port = std::to_string(static_cast<int>(args[1].asNumber()));
 
         addrinfo hints{}, *res;
         hints.ai_family = AF_INET;
@@ -49,11 +61,11 @@ struct NativeSend final : Callable {
         return 2;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]) || !std::holds_alternative<std::string>(args[1]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber() || !args[1].isString())
             return -1.0;
-        const int fd = static_cast<int>(std::get<double>(args[0]));
-        const auto d = std::get<std::string>(args[1]);
+        const int fd = static_cast<int>(args[0].asNumber());
+        const std::string& d = args[1].asString();
         return static_cast<double>(send(fd, d.c_str(), d.length(), 0));
     }
 
@@ -67,15 +79,15 @@ struct NativeRecv final : Callable {
         return 2;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]) || !std::holds_alternative<double>(args[1]))
-            return std::monostate{};
-        const int fd = static_cast<int>(std::get<double>(args[0]));
-        const int sz = static_cast<int>(std::get<double>(args[1]));
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber() || !args[1].isNumber())
+            return Value();
+        const int fd = static_cast<int>(args[0].asNumber());
+        const int sz = static_cast<int>(args[1].asNumber());
         std::vector<char> buf(sz);
         if (const ssize_t n = recv(fd, buf.data(), sz, 0); n > 0)
             return std::string(buf.data(), n);
-        return std::monostate{};
+        return Value();
     }
 
     std::string toString() override {
@@ -88,10 +100,13 @@ struct NativeClose final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]))
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isNumber())
             return false;
-        close(static_cast<int>(std::get<double>(args[0])));
+        const int fd = static_cast<int>(args[0].asNumber());
+        // A later socket may reuse the number; it must not inherit callbacks.
+        interpreter.getCore().getLoop().forget(fd);
+        close(fd);
         return true;
     }
 
@@ -100,58 +115,27 @@ struct NativeClose final : Callable {
     }
 };
 
+// Appends the response body to `body`.
+inline HttpParser::Sink collect(std::string& body) {
+    return [&body](const char* data, const size_t size) {
+        body.append(data, size);
+        return true;
+    };
+}
+
 struct NativeHttpGet final : Callable {
     int arity() override {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]))
-            return std::monostate{};
-        auto url = std::get<std::string>(args[0]);
-
-        if (url.substr(0, 7) == "http://")
-            url = url.substr(7);
-
-        const size_t slash = url.find('/');
-        std::string host = (slash == std::string::npos) ? url : url.substr(0, slash);
-        const std::string path = (slash == std::string::npos) ? "/" : url.substr(slash);
-
-        std::string port = "80";
-        const size_t colon = host.find(':');
-        if (colon != std::string::npos) {
-            port = host.substr(colon + 1);
-            host = host.substr(0, colon);
-        }
-
-        addrinfo hints{}, *res;
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
-            return std::monostate{};
-
-        const int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-        if (fd == -1) {
-            freeaddrinfo(res); return std::monostate{};
-        }
-        
-        if (connect(fd, res->ai_addr, res->ai_addrlen) == -1) {
-            close(fd); freeaddrinfo(res); return std::monostate{};
-        }
-        freeaddrinfo(res);
-
-        const std::string req = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
-        send(fd, req.c_str(), req.length(), 0);
-
-        std::string raw;
-        char buf[4096];
-        ssize_t n;
-        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) raw.append(buf, n);
-        close(fd);
-
-        size_t headers_end = raw.find("\r\n\r\n");
-        if (headers_end != std::string::npos) return raw.substr(headers_end + 4);
-        return raw;
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isString())
+            return Value();
+        std::string body;
+        HttpClient::Response response;
+        if (!interpreter.getCore().getHttp().request("GET", args[0].asString(), {}, nullptr, collect(body), response))
+            return Value();
+        return body;
     }
     std::string toString() override { return "<native fn http_get>"; }
 };
@@ -161,72 +145,140 @@ struct NativeHttpPost final : Callable {
         return 2;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) 
-            return std::monostate{};
-        auto url = std::get<std::string>(args[0]);
-        const auto body = std::get<std::string>(args[1]);
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isString() || !args[1].isString()) 
+            return Value();
+        std::string body;
+        HttpClient::Response response;
+        if (!interpreter.getCore().getHttp().request("POST", args[0].asString(), {}, &args[1].asString(),
+                                                     collect(body), response))
+            return Value();
+        return body;
+    }
+        std::string toString() override {
+          return "<native fn http_post>";
+        }
+    };
 
-        if (url.substr(0, 7) == "http://") url = url.substr(7);
-        const size_t slash = url.find('/');
-        std::string host = (slash == std::string::npos) ? url : url.substr(0, slash);
-        const std::string path = (slash == std::string::npos) ? "/" : url.substr(slash);
+// http_request(method, url, headers, body) and, with a fifth argument,
+// http_stream(method, url, headers, body, target). `headers` is a map or
+// null, `body` a string or null. Both return a map with the status, reason
+// and headers (names lowercased, repeats joined with ", "), plus the body
+// for http_request, or the number of bytes streamed for http_stream, which
+// hands the body in pieces to a file path or fn(chunk) instead of holding
+// it. Returns null if the request fails, or fn returns false.
+struct NativeHttpRequest final : Callable {
+    const bool streaming;
 
-        std::string port = "80";
-        const size_t colon = host.find(':');
-        if (colon != std::string::npos) {
-            port = host.substr(colon + 1);
-            host = host.substr(0, colon);
-        }
+    explicit NativeHttpRequest(const bool streaming) : streaming(streaming) {}
 
-        addrinfo hints{}, *res;
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
-            return std::monostate{};
+    int arity() override {
+        return streaming ? 5 : 4;
+    }
 
-        const int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-        if (fd == -1) { freeaddrinfo(res);
-            return std::monostate{}; }
-        
-        if (connect(fd, res->ai_addr, res->ai_addrlen) == -1) {
-            close(fd); freeaddrinfo(res);
-            return std::monostate{};
+    Value call(Interpreter& interpreter, Arguments args) override {
+        if (!args[0].isString() || !args[1].isString() || !(args[3].isNull() || args[3].isString()))
+            return Value();
+
+        std::vector<HttpParser::Header> headers;
+        if (args[2].isMap()) {
+            for (const LiteralMap::Entry& entry : args[2].asMap()->entries()) {
+                if (!entry.live) continue;
+                if (!entry.key.isString())
+                    return Value();
+                headers.emplace_back(entry.key.asString(), Interpreter::stringify(entry.value));
+            }
+        } else if (!args[2].isNull()) {
+            return Value();
         }
-        freeaddrinfo(res);
 
-        const std::string req = "POST " + path + " HTTP/1.1\r\n" +
-                          "Host: " + host + "\r\n" +
-                          "Content-Length: " + std::to_string(body.length()) + "\r\n" +
-                          "Content-Type: text/plain\r\n" +
-                          "Connection: close\r\n\r\n" + body;
-        send(fd, req.c_str(), req.length(), 0);
-
-        std::string raw;
-        char buf[4096];
-        ssize_t n;
-        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) raw.append(buf, n);
-        close(fd);
+        std::string method = args[0].asString();
+        for (char& c : method) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        const std::string* body = args[3].isNull() ? nullptr : &args[3].asString();
+        HttpClient& http = interpreter.getCore().getHttp();
+        HttpClient::Response response;
+
+        if (!streaming) {
+            std::string content;
+            if (!http.request(method, args[1].asString(), headers, body, collect(content), response))
+                return Value();
+            Value result = describe(response);
+            result.asMap()->set("body", std::move(content));
+            return result;
+        }
 
-        size_t headers_end = raw.find("\r\n\r\n");
-        if (headers_end != std::string::npos) return raw.substr(headers_end + 4);
-        return raw;
+        bool ok;
+        if (args[4].isString()) {
+            const int fd = open(args[4].asString().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd == -1)
+                return Value();
+            ok = http.request(method, args[1].asString(), headers, body, [fd](const char* data, size_t size) {
+                while (size > 0) {
+                    const ssize_t n = write(fd, data, size);
+                    if (n == -1 && errno == EINTR) continue;
+                    if (n <= 0) return false;
+                    data += n;
+                    size -= static_cast<size_t>(n);
+                }
+                return true;
+            }, response);
+            ok = close(fd) == 0 && ok;
+        } else if (isCallback(args[4], 1)) {
+            const Value callback = args[4];
+            std::vector<Value> chunk(1);
+            ok = http.request(method, args[1].asString(), headers, body, [&](const char* data, const size_t size) {
+                chunk[0] = std::string(data, size);
+                const Value result = callback.asCallable()->call(interpreter, Arguments(chunk));
+                return !(result.isBool() && !result.asBool());
+            }, response);
+        } else {
+            return Value();
+        }
+        if (!ok)
+            return Value();
+        Value result = describe(response);
+        result.asMap()->set("size", static_cast<double>(response.size));
+        return result;
     }
-        std::string toString() override {
-          return "<native fn http_post>";
+
+    std::string toString() override {
+        return streaming ? "<native fn http_stream>" : "<native fn http_request>";
+    }
+
+private:
+    static Value describe(const HttpClient::Response& response) {
+        Value headers = Value::make<LiteralMap>();
+        LiteralMap* fields = headers.asMap();
+        for (const auto& [name, value] : response.headers) {
+            std::string key = name;
+            for (char& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            const Value field(key);
+            if (const Value* seen = fields->find(field)) {
+                fields->set(field, seen->asString() + ", " + value);
+            } else {
+                fields->set(field, value);
+            }
         }
-    };
-    
+
+        Value result = Value::make<LiteralMap>();
+        LiteralMap* map = result.asMap();
+        map->set("status", static_cast<double>(response.status));
+        map->set("reason", response.reason);
+        map->set("headers", std::move(headers));
+        return result;
+    }
+};
+
 struct NativeListen final : Callable {
     int arity() override {
       return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber())
           return -1.0;
 
-        const auto port = static_cast<int>(std::get<double>(args[0]));
+        const auto port = static_cast<int>(args[0].asNumber());
         const auto fd = socket(AF_INET, SOCK_STREAM, 0);
         if (fd == -1) return -1.0;
 
@@ -243,7 +295,7 @@ struct NativeListen final : Callable {
             return -1.0;
         }
 
-        if (listen(fd, 10) == -1) {
+        if (listen(fd, SOMAXCONN) == -1) {
             close(fd);
             return -1.0;
         }
@@ -261,11 +313,11 @@ struct NativeAccept final : Callable {
       return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber())
           return -1.0;
 
-        const auto server_fd = static_cast<int>(std::get<double>(args[0]));
+        const auto server_fd = static_cast<int>(args[0].asNumber());
         const auto client_fd = accept(server_fd, nullptr, nullptr);
 
         return static_cast<double>(client_fd);
@@ -275,5 +327,254 @@ struct NativeAccept final : Callable {
       return "<native fn accept>";
     }
 };
+
+// Non-blocking variants, for sockets driven by run_loop(). None of them waits
+// on a peer; a call that would is reported in its return value instead.
+
+// Starts connecting and returns the fd at once. It becomes writable when the
+// connection is up, or fails; send_nb then returns -1. The host lookup
+// itself still blocks.
+struct NativeConnectNb final : Callable {
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString() || !args[1].isNumber())
+            return -1.0;
+
+        const std::string& host = args[0].asString();
+        const std::string port = std::to_string(static_cast<int>(args[1].asNumber()));
+
+        addrinfo hints{}, *res;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
+            return -1.0;
+
+        const int fd = openSocket(res->ai_family, res->ai_socktype, true);
+        if (fd == -1) { freeaddrinfo(res);
+            return -1.0; }
+
+        if (connect(fd, res->ai_addr, res->ai_addrlen) == -1 && errno != EINPROGRESS) { close(fd); freeaddrinfo(res);
+            return -1.0; }
+        freeaddrinfo(res);
+
+        return static_cast<double>(fd);
+    }
+
+    std::string toString() override {
+        return "<native fn connect_nb>";
+    }
+};
+
+// Returns a pending client's fd, itself non-blocking, or -1 if there is none.
+// Makes the listening socket non-blocking too.
+struct NativeAcceptNb final : Callable {
+    int arity() override {
+        return 1;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber())
+            return -1.0;
+
+        const auto server_fd = static_cast<int>(args[0].asNumber());
+        if (const int flags = fcntl(server_fd, F_GETFL); flags != -1 && !(flags & O_NONBLOCK))
+            fcntl(server_fd, F_SETFL, flags | O_NONBLOCK);
+
+        return static_cast<double>(acceptSocket(server_fd, true));
+    }
+
+    std::string toString() override {
+        return "<native fn accept_nb>";
+    }
+};
+
+// Returns the number of bytes sent, which may be fewer than given, 0 if the
+// socket buffer is full, or -1 on error.
+struct NativeSendNb final : Callable {
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber() || !args[1].isString())
+            return -1.0;
+        const int fd = static_cast<int>(args[0].asNumber());
+        const std::string& d = args[1].asString();
+        // A peer that hung up must not take the whole loop down with SIGPIPE.
+        const ssize_t n = sendQuietly(fd, d.c_str(), d.length(), MSG_DONTWAIT);
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0.0;
+        return static_cast<double>(n);
+    }
+
+    std::string toString() override {
+        return "<native fn send_nb>";
+    }
+};
+
+// Returns what has arrived, up to `size` bytes, "" if nothing has, or null
+// once the peer has closed or the socket failed.
+struct NativeRecvNb final : Callable {
+    int arity() override {
+        return 2;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber() || !args[1].isNumber())
+            return Value();
+        const int fd = static_cast<int>(args[0].asNumber());
+        const int sz = static_cast<int>(args[1].asNumber());
+        if (sz <= 0)
+            return Value();
+        std::vector<char> buf(sz);
+        const ssize_t n = recv(fd, buf.data(), sz, MSG_DONTWAIT);
+        if (n > 0)
+            return std::string(buf.data(), n);
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return std::string();
+        return Value();
+    }
+
+    std::string toString() override {
+        return "<native fn recv_nb>";
+    }
+};
     
-#endif
\ No newline at end of file
+// scan(host, ports, timeout_ms, concurrency): Returns the ports from the
+// array that accept a TCP connection, in ascending order. Keeps up to
+// `concurrency` non-blocking connects in flight and gives each `timeout_ms`,
+// so a filtered port costs the timeout rather than the kernel's SYN retries.
+// The host is resolved once. Returns null if it cannot be.
+struct NativeScan final : Callable {
+    int arity() override {
+        return 4;
+    }
+
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString() || !args[1].isArray() || !args[2].isNumber() || !args[3].isNumber())
+            return Value();
+
+        addrinfo hints{}, *info;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(args[0].asString().c_str(), nullptr, &hints, &info) != 0)
+            return Value();
+        sockaddr_in addr{};
+        std::memcpy(&addr, info->ai_addr, sizeof(addr));
+        freeaddrinfo(info);
+
+        std::vector<int> ports;
+        for (const Value& port : args[1].asArray()->elements) {
+            if (port.isNumber() && port.asNumber() >= 1 && port.asNumber() <= 65535)
+                ports.push_back(static_cast<int>(port.asNumber()));
+        }
+
+        // Leaves room under the descriptor limit for the script's own files.
+        const size_t limit = EventLoop::raiseFileLimit();
+        const size_t spare = limit > 128 ? limit - 64 : 64;
+        const size_t width = std::clamp<size_t>(static_cast<size_t>(std::max(args[3].asNumber(), 1.0)), 1, spare);
+        const auto timeout = std::chrono::duration<double, std::milli>(std::max(args[2].asNumber(), 1.0));
+
+        Poller poller;
+        if (!poller.open())
+            return Value();
+
+        // Every probe gets the same timeout, so they expire in the order they
+        // started: the oldest is always at the front.
+        struct Probe {
+            int fd;
+            int port;
+            std::chrono::steady_clock::time_point deadline;
+            bool done;
+        };
+        std::deque<Probe> inFlight;
+        uint64_t first = 0;
+        size_t active = 0;
+        size_t next = 0;
+        std::vector<int> open;
+
+        const auto finish = [&](Probe& probe, const bool connected) {
+            // On loopback a connect to a free ephemeral port can pick that same
+            // port as its source and connect to itself; nothing listens there.
+            sockaddr_in local{};
+            socklen_t length = sizeof(local);
+            if (connected && !(getsockname(probe.fd, reinterpret_cast<sockaddr*>(&local), &length) == 0 &&
+                               local.sin_port == htons(probe.port) && local.sin_addr.s_addr == addr.sin_addr.s_addr))
+                open.push_back(probe.port);
+            poller.remove(probe.fd);
+            close(probe.fd);
+            probe.done = true;
+            active--;
+        };
+
+        std::vector<Poller::Event> events;
+        while (next < ports.size() || active > 0) {
+            bool starved = false;
+            while (active < width && next < ports.size()) {
+                const int fd = openSocket(AF_INET, SOCK_STREAM, true);
+                if (fd == -1) {
+                    starved = true;
+                    break;
+                }
+                const int port = ports[next++];
+                addr.sin_port = htons(port);
+                const int rc = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+                const uint64_t seq = first + inFlight.size();
+                inFlight.push_back({fd, port, std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout), false});
+                active++;
+                if (rc == 0 || errno != EINPROGRESS) {
+                    finish(inFlight.back(), rc == 0);
+                    continue;
+                }
+                poller.set(fd, seq, false, true);
+            }
+            if (active == 0) {
+                // Out of descriptors with none of ours left to free one.
+                if (starved)
+                    break;
+                first += inFlight.size();
+                inFlight.clear();
+                continue;
+            }
+
+            while (!inFlight.empty() && inFlight.front().done) {
+                inFlight.pop_front();
+                first++;
+            }
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                inFlight.front().deadline - std::chrono::steady_clock::now()).count();
+            poller.wait(static_cast<int>(std::max<long long>(wait + 1, 0)), std::min<size_t>(width, 1024), events);
+            for (const Poller::Event& event : events) {
+                Probe& probe = inFlight[event.key - first];
+                if (probe.done) continue;
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                finish(probe, error == 0);
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            for (Probe& probe : inFlight) {
+                if (probe.deadline > now) break;
+                if (!probe.done) finish(probe, false);
+            }
+        }
+
+        std::sort(open.begin(), open.end());
+        Value res = Value::make<LiteralVector>();
+        auto& elements = res.asArray()->elements;
+        elements.reserve(open.size());
+        for (const int port : open) elements.emplace_back(static_cast<double>(port));
+        return res;
+    }
+
+    std::string toString() override {
+        return "<native fn scan>";
+    }
+};
+
+#endif
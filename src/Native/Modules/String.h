@@ -2,7 +2,8 @@
 #define CIPR_NATIVE_STRING_H
 
 #include "Interpreter/Callable.h"
-#include "Token/Token.h" // For LiteralVector
+#include "Value/Value.h" // For LiteralVector
+#include "Value/Map.h"
 #include <algorithm>
 #include <cctype>
 
@@ -11,11 +12,13 @@ struct NativeSize final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (std::holds_alternative<std::shared_ptr<LiteralVector>>(args[0]))
-            return static_cast<double>(std::get<std::shared_ptr<LiteralVector> >(args[0])->elements.size());
-        if (std::holds_alternative<std::string>(args[0]))
-            return static_cast<double>(std::get<std::string>(args[0]).length());
+    Value call(Interpreter&, Arguments args) override {
+        if (args[0].isArray())
+            return static_cast<double>(args[0].asArray()->elements.size());
+        if (args[0].isMap())
+            return static_cast<double>(args[0].asMap()->size());
+        if (args[0].isString())
+            return static_cast<double>(args[0].asString().length());
         return 0.0;
     }
 
@@ -29,16 +32,15 @@ struct NativeTrim final : Callable {
         return 1;
     }
 
-    Literal call(Interpreter&, std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0])) return args[0];
-        auto s = std::get<std::string>(args[0]);
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](const unsigned char ch) {
-            return !std::isspace(ch);
-        }));
-        s.erase(std::find_if(s.rbegin(), s.rend(), [](const unsigned char ch) {
-            return !std::isspace(ch);
-        }).base(), s.end());
-        return s;
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString()) return args[0];
+        const std::string& s = args[0].asString();
+        const auto notSpace = [](const unsigned char ch) { return !std::isspace(ch); };
+        const auto first = std::find_if(s.begin(), s.end(), notSpace);
+        const auto last = std::find_if(s.rbegin(), std::make_reverse_iterator(first), notSpace).base();
+        if (first == s.begin() && last == s.end())
+            return args[0];
+        return std::string(first, last);
     }
 
     std::string toString() override {
@@ -51,18 +53,20 @@ struct NativeSplit final : Callable {
         return 2;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<std::string>(args[0]) || !std::holds_alternative<std::string>(args[1])) 
-            return std::make_shared<LiteralVector>();
-        auto s = std::get<std::string>(args[0]);
-        const auto d = std::get<std::string>(args[1]);
-        auto res = std::make_shared<LiteralVector>();
-        size_t pos = 0;
-        while ((pos = s.find(d)) != std::string::npos) {
-            res->elements.emplace_back(s.substr(0, pos));
-            s.erase(0, pos + d.length());
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isString() || !args[1].isString()) 
+            return Value::make<LiteralVector>();
+        const std::string& s = args[0].asString();
+        const std::string& d = args[1].asString();
+        Value res = Value::make<LiteralVector>();
+        auto& elements = res.asArray()->elements;
+        size_t begin = 0;
+        size_t pos;
+        while (!d.empty() && (pos = s.find(d, begin)) != std::string::npos) {
+            elements.emplace_back(s.substr(begin, pos - begin));
+            begin = pos + d.length();
         }
-        res->elements.emplace_back(s);
+        elements.emplace_back(s.substr(begin));
         return res;
     }
 
@@ -76,27 +80,27 @@ struct NativeExtract final : Callable {
         return 3;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
+    Value call(Interpreter&, Arguments args) override {
 
-        if (!std::holds_alternative<std::string>(args[0]) ||
-            !std::holds_alternative<std::string>(args[1]) ||
-            !std::holds_alternative<std::string>(args[2]))
-            return std::monostate{};
+        if (!args[0].isString() ||
+            !args[1].isString() ||
+            !args[2].isString())
+            return Value();
 
-        auto src = std::get<std::string>(args[0]);
-        const auto start = std::get<std::string>(args[1]);
-        const auto end = std::get<std::string>(args[2]);
+        const std::string& src = args[0].asString();
+        const std::string& start = args[1].asString();
+        const std::string& end = args[2].asString();
 
         size_t s_pos = src.find(start);
 
         if (s_pos == std::string::npos)
-            return std::monostate{};
+            return Value();
 
         s_pos += start.length();
         const size_t e_pos = src.find(end, s_pos);
 
         if (e_pos == std::string::npos)
-            return std::monostate{};
+            return Value();
 
         return src.substr(s_pos, e_pos - s_pos);
 
@@ -14,8 +14,8 @@ struct NativePs final : Callable {
       return 0;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal>) override {
-        auto list = std::make_shared<LiteralVector>();
+    Value call(Interpreter&, Arguments) override {
+        Value list = Value::make<LiteralVector>();
         try {
             for (const auto& entry : std::filesystem::directory_iterator("/proc")) {
                 if (!entry.is_directory())
@@ -27,11 +27,11 @@ struct NativePs final : Callable {
 
                 std::ifstream comm_file(entry.path() / "comm");
                 if (std::string name; comm_file >> name) {
-                    list->elements.emplace_back(pid_str + ": " + name);
+                    list.asArray()->elements.emplace_back(pid_str + ": " + name);
                 }
             }
         } catch (...) {
-            return std::monostate{};
+            return Value();
         }
         return list;
     }
@@ -46,11 +46,11 @@ struct NativeKill final : Callable {
       return 1;
     }
 
-    Literal call(Interpreter&, const std::vector<Literal> args) override {
-        if (!std::holds_alternative<double>(args[0]))
+    Value call(Interpreter&, Arguments args) override {
+        if (!args[0].isNumber())
           return false;
         
-        const auto pid = static_cast<int>(std::get<double>(args[0]));
+        const auto pid = static_cast<int>(args[0].asNumber());
         return kill(pid, SIGTERM) == 0;
     }
 
@@ -2,49 +2,80 @@
 #include "Modules/Core.h"
 #include "Modules/File.h"
 #include "Modules/Net.h"
+#include "Modules/Loop.h"
 #include "Modules/String.h"
+#include "Modules/Map.h"
 #include "Modules/Crypto.h"
 #include "Modules/Sys.h"
 
 void NativeRegistry::registerAll(const std::shared_ptr<Environment>& env) {
     // Core
-    env->define("time", std::make_shared<NativeTime>());
-    env->define("run", std::make_shared<NativeRun>());
-    env->define("env", std::make_shared<NativeEnv>());
-    env->define("cwd", std::make_shared<NativeCwd>());
-    env->define("cd", std::make_shared<NativeCd>());
-    env->define("include", std::make_shared<NativeInclude>());
-    env->define("rand", std::make_shared<NativeRand>());
-    env->define("sleep", std::make_shared<NativeSleep>());
-    env->define("exit", std::make_shared<NativeExit>());
+    env->define("time", Value::make<NativeTime>());
+    env->define("run", Value::make<NativeRun>());
+    env->define("env", Value::make<NativeEnv>());
+    env->define("cwd", Value::make<NativeCwd>());
+    env->define("cd", Value::make<NativeCd>());
+    env->define("include", Value::make<NativeInclude>());
+    env->define("reload", Value::make<NativeInclude>(true));
+    env->define("module_stats", Value::make<NativeModuleStats>());
+    env->define("modules", Value::make<NativeModules>());
+    env->define("rand", Value::make<NativeRand>());
+    env->define("sleep", Value::make<NativeSleep>());
+    env->define("exit", Value::make<NativeExit>());
+    env->define("gc_stats", Value::make<NativeGcStats>());
+    env->define("gc_collect", Value::make<NativeGcCollect>());
+    env->define("gc_tune", Value::make<NativeGcTune>());
 
     // File
-    env->define("read_file", std::make_shared<NativeReadFile>());
-    env->define("write_file", std::make_shared<NativeWriteFile>());
-    env->define("ls", std::make_shared<NativeLs>());
+    env->define("read_file", Value::make<NativeReadFile>());
+    env->define("write_file", Value::make<NativeWriteFile>());
+    env->define("ls", Value::make<NativeLs>());
 
     // String
-    env->define("size", std::make_shared<NativeSize>());
-    env->define("trim", std::make_shared<NativeTrim>());
-    env->define("split", std::make_shared<NativeSplit>());
-    env->define("extract", std::make_shared<NativeExtract>());
+    env->define("size", Value::make<NativeSize>());
+    env->define("trim", Value::make<NativeTrim>());
+    env->define("split", Value::make<NativeSplit>());
+    env->define("extract", Value::make<NativeExtract>());
+
+    // Map
+    env->define("keys", Value::make<NativeKeys>());
+    env->define("values", Value::make<NativeValues>());
+    env->define("has", Value::make<NativeHas>());
+    env->define("remove", Value::make<NativeRemove>());
 
     // Net
-    env->define("connect", std::make_shared<NativeConnect>());
-    env->define("send", std::make_shared<NativeSend>());
-    env->define("recv", std::make_shared<NativeRecv>());
-    env->define("close", std::make_shared<NativeClose>());
-    env->define("http_get", std::make_shared<NativeHttpGet>());
-    env->define("http_post", std::make_shared<NativeHttpPost>());
-    env->define("listen", std::make_shared<NativeListen>());
-    env->define("accept", std::make_shared<NativeAccept>());
+    env->define("connect", Value::make<NativeConnect>());
+    env->define("send", Value::make<NativeSend>());
+    env->define("recv", Value::make<NativeRecv>());
+    env->define("close", Value::make<NativeClose>());
+    env->define("http_get", Value::make<NativeHttpGet>());
+    env->define("http_post", Value::make<NativeHttpPost>());
+    env->define("http_request", Value::make<NativeHttpRequest>(false));
+    env->define("http_stream", Value::make<NativeHttpRequest>(true));
+    env->define("listen", Value::make<NativeListen>());
+    env->define("accept", Value::make<NativeAccept>());
+    env->define("connect_nb", Value::make<NativeConnectNb>());
+    env->define("accept_nb", Value::make<NativeAcceptNb>());
+    env->define("send_nb", Value::make<NativeSendNb>());
+    env->define("recv_nb", Value::make<NativeRecvNb>());
+    env->define("scan", Value::make<NativeScan>());
+
+    // Loop
+    env->define("on_readable", Value::make<NativeOnReady>(false));
+    env->define("on_writable", Value::make<NativeOnReady>(true));
+    env->define("set_timeout", Value::make<NativeSetTimer>(false));
+    env->define("set_interval", Value::make<NativeSetTimer>(true));
+    env->define("clear_timer", Value::make<NativeClearTimer>());
+    env->define("run_loop", Value::make<NativeRunLoop>());
+    env->define("stop_loop", Value::make<NativeStopLoop>());
+    env->define("serve", Value::make<NativeServe>());
 
     // Crypto
-    env->define("hex", std::make_shared<NativeHex>());
-    env->define("base64_encode", std::make_shared<NativeBase64Encode>());
-    env->define("base64_decode", std::make_shared<NativeBase64Decode>());
+    env->define("hex", Value::make<NativeHex>());
+    env->define("base64_encode", Value::make<NativeBase64Encode>());
+    env->define("base64_decode", Value::make<NativeBase64Decode>());
 
     // Sys
-    env->define("ps", std::make_shared<NativePs>());
-    env->define("kill", std::make_shared<NativeKill>());
+    env->define("ps", Value::make<NativePs>());
+    env->define("kill", Value::make<NativeKill>());
 }
@@ -0,0 +1,220 @@
+#include "Optimizer.h"
+
+#include "Interpreter/Interpreter.h"
+
+int Optimizer::optimize(const int rootIndex) {
+    return statement(rootIndex);
+}
+
+int Optimizer::statement(const int index) {
+    if (index == -1)
+        return -1;
+
+    // Children are re-read after each recursive call: folding can move them
+    // to a new range of the Arena's child buffer.
+    switch (Node node = arena.get(index); node.type()) {
+        case NodeType::STMT_LIST:
+            statements(node);
+            break;
+        case NodeType::STMT_BLOCK:
+            statements(node);
+            if (node.children().size() == 1 && declaresNothing(node)) {
+                return node.child(0);
+            }
+            break;
+        case NodeType::STMT_FUNCTION: {
+            // The body block holds the parameter scope, so it stays a block.
+            Node body = arena.get(node.children().back());
+            statements(body);
+            break;
+        }
+        case NodeType::STMT_IF: {
+            node.setChild(0, expression(node.child(0)));
+            node.setChild(1, statement(node.child(1)));
+            node.setChild(2, statement(node.child(2)));
+            if (!isLiteral(node.child(0)))
+                break;
+
+            const int taken = Interpreter::isTruthy(arena.get(node.child(0)).value())
+                ? node.child(1) : node.child(2);
+            if (taken != -1) {
+                return taken;
+            }
+            makeEmpty(node);
+            break;
+        }
+        case NodeType::STMT_WHILE:
+            node.setChild(0, expression(node.child(0)));
+            node.setChild(1, statement(node.child(1)));
+            if (isLiteral(node.child(0)) &&
+                !Interpreter::isTruthy(arena.get(node.child(0)).value())) {
+                makeEmpty(node);
+            }
+            break;
+        case NodeType::STMT_VAR_DECL:
+        case NodeType::STMT_ECHO:
+        case NodeType::STMT_EXPR:
+        case NodeType::STMT_RETURN:
+            for (size_t i = 0; i < node.children().size(); i++) {
+                node.setChild(i, expression(node.child(i)));
+            }
+            break;
+        default:
+            return expression(index);
+    }
+    return index;
+}
+
+void Optimizer::statements(Node& list) {
+    // A copy: the recursive calls may grow the child buffer.
+    const Children children = list.children();
+    const std::vector<int> original(children.begin(), children.end());
+    std::vector<int> result;
+    result.reserve(original.size());
+
+    for (const int childIndex : original) {
+        const int optimized = statement(childIndex);
+        if (optimized == -1)
+            continue;
+
+        // A block that declares nothing has no scope of its own, so its
+        // statements can run directly in the enclosing one.
+        if (const Node child = arena.get(optimized);
+            child.type() == NodeType::STMT_BLOCK && declaresNothing(child)) {
+            const Children inner = child.children();
+            result.insert(result.end(), inner.begin(), inner.end());
+        } else {
+            result.push_back(optimized);
+        }
+    }
+
+    list.setChildren(result);
+}
+
+int Optimizer::expression(const int index) {
+    if (index == -1)
+        return -1;
+
+    Node node = arena.get(index);
+    if (node.type() == NodeType::GROUPING) {
+        return expression(node.child(0));
+    }
+
+    for (size_t i = 0; i < node.children().size(); i++) {
+        node.setChild(i, expression(node.child(i)));
+    }
+
+    switch (node.type()) {
+        case NodeType::UNARY:
+            foldUnary(node);
+            break;
+        case NodeType::BINARY:
+            foldBinary(node);
+            break;
+        case NodeType::LOGICAL: {
+            if (!isLiteral(node.child(0)))
+                break;
+            // Same short-circuit rule as Interpreter::visitLogicalExpr.
+            const bool truthy = Interpreter::isTruthy(arena.get(node.child(0)).value());
+            if ((node.op() == OR) == truthy) {
+                return node.child(0);
+            }
+            return node.child(1);
+        }
+        default:
+            break;
+    }
+    return index;
+}
+
+bool Optimizer::isLiteral(const int index) const {
+    return index != -1 && arena.get(index).type() == NodeType::LITERAL;
+}
+
+bool Optimizer::declaresNothing(const Node& block) const {
+    for (const int childIndex : block.children()) {
+        if (childIndex == -1) continue;
+        const NodeType type = arena.get(childIndex).type();
+        if (type == NodeType::STMT_VAR_DECL || type == NodeType::STMT_FUNCTION) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Optimizer::makeEmpty(Node& node) {
+    node.setType(NodeType::STMT_BLOCK);
+    node.setChildren({});
+}
+
+void Optimizer::fold(Node& node, Value value) {
+    node.setChildren({});
+    node.makeLiteral(std::move(value));
+}
+
+bool Optimizer::foldUnary(Node& node) const {
+    if (!isLiteral(node.child(0)))
+        return false;
+
+    // A copy: fold() may grow the constant table this lives in.
+    const Value operand = arena.get(node.child(0)).value();
+    switch (node.op()) {
+        case MINUS:
+            if (!operand.isNumber())
+                return false;
+            fold(node, -operand.asNumber());
+            return true;
+        case BANG:
+            fold(node, !Interpreter::isTruthy(operand));
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Optimizer::foldBinary(Node& node) const {
+    if (!isLiteral(node.child(0)) || !isLiteral(node.child(1)))
+        return false;
+
+    // Copies: fold() may grow the constant table these live in.
+    const Value left = arena.get(node.child(0)).value();
+    const Value right = arena.get(node.child(1)).value();
+
+    switch (node.op()) {
+        case EQUAL_EQUAL:
+            fold(node, Interpreter::isEqual(left, right));
+            return true;
+        case BANG_EQUAL:
+            fold(node, !Interpreter::isEqual(left, right));
+            return true;
+        case PLUS:
+            if (left.isString() || right.isString()) {
+                fold(node, Interpreter::concatenate(left, right));
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (!left.isNumber() || !right.isNumber())
+        return false;
+
+    const double a = left.asNumber();
+    const double b = right.asNumber();
+    switch (node.op()) {
+        case PLUS: fold(node, a + b); return true;
+        case MINUS: fold(node, a - b); return true;
+        case STAR: fold(node, a * b); return true;
+        case SLASH:
+            if (b == 0.0)
+                return false;
+            fold(node, a / b);
+            return true;
+        case GREATER: fold(node, a > b); return true;
+        case GREATER_EQUAL: fold(node, a >= b); return true;
+        case LESS: fold(node, a < b); return true;
+        case LESS_EQUAL: fold(node, a <= b); return true;
+        default: return false;
+    }
+}
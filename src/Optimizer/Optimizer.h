@@ -0,0 +1,36 @@
+#ifndef CIPR_OPTIMIZER_H
+#define CIPR_OPTIMIZER_H
+
+#include <vector>
+#include "AST/Node.h"
+
+// Runs between Parser::parse and the Resolver (or Compiler), simplifying the
+// Arena in place: constant subexpressions become LITERALs, GROUPINGs are
+// dropped, branches and loops with constant conditions are reduced to what
+// would actually run, and blocks that declare nothing are merged into their
+// parent. Anything that would raise a runtime error is left as written so
+// the error still surfaces at run time on the same line.
+class Optimizer {
+public:
+    explicit Optimizer(Arena& arena) : arena(arena) {}
+
+    // Returns the index that should take `rootIndex`'s place.
+    int optimize(int rootIndex);
+
+private:
+    Arena& arena;
+
+    int statement(int index);
+    int expression(int index);
+    void statements(Node& list);
+
+    bool isLiteral(int index) const;
+    bool declaresNothing(const Node& block) const;
+    static void makeEmpty(Node& node);
+    static void fold(Node& node, Value value);
+
+    bool foldUnary(Node& node) const;
+    bool foldBinary(Node& node) const;
+};
+
+#endif //CIPR_OPTIMIZER_H
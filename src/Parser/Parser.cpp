@@ -4,33 +4,37 @@
 
 #include "Parser.h"
 
-#include <iostream>
-#include <ostream>
 #include "Core/Core.h"
+#include "Scanner/Scanner.h"
 
 int Parser::parse() {
-    std::vector<int> statements;
+    // A script has fewer nodes than tokens; capacity it never touches costs
+    // no memory.
+    arena.reserve(tokens.size());
+    const size_t mark = pending.size();
 
     while (!isAtEnd()) {
-        statements.push_back(declaration());
+        pending.push_back(declaration());
     }
 
-    return arena.addNode(NodeType::STMT_LIST, previous(), previous().literal, statements);
+    return addNode(NodeType::STMT_LIST, previous(), mark);
 }
 
-std::vector<int> Parser::block() {
-    std::vector<int> statements;
+// Leaves the statements pending and returns where they start.
+size_t Parser::block() {
+    const size_t mark = pending.size();
 
     while (!check(RIGHT_BRACE) && !isAtEnd()) {
-        statements.push_back(declaration());
+        pending.push_back(declaration());
     }
 
     consume(RIGHT_BRACE, "Expect '}' after block.");
 
-    return statements;
+    return mark;
 }
 
 int Parser::declaration() {
+    const size_t mark = pending.size();
     try {
         if (match({FN})) return function("function");
         if (match({LET})) {
@@ -38,6 +42,7 @@ int Parser::declaration() {
         }
         return statement();
     } catch ([[maybe_unused]] const ParseError& e) {
+        pending.resize(mark);
         synchronize();
         return -1;
     }
@@ -65,15 +70,15 @@ int Parser::statement() {
     }
 
     if (match({LEFT_BRACE})) {
-        const std::vector<int> statements = block();
-        return arena.addNode(NodeType::STMT_BLOCK, previous(), std::monostate{}, statements);
+        const size_t mark = block();
+        return addNode(NodeType::STMT_BLOCK, previous(), mark);
     }
 
     return expressionStatement();
 }
 
 int Parser::varDeclaration() {
-    const Token name = consume(IDENTIFIER, "Expect variable name.");
+    const Token& name = consume(IDENTIFIER, "Expect variable name.");
 
     int initializer = -1;
     if (match({EQUAL})) {
@@ -82,51 +87,44 @@ int Parser::varDeclaration() {
 
     consume(SEMICOLON, "Expected ';' after declaration");
 
-    return arena.addNode(NodeType::STMT_VAR_DECL, name, std::monostate{}, {initializer});
+    return addNode(NodeType::STMT_VAR_DECL, name, {initializer});
 }
 
-int Parser::function(const std::string& kind) {
-    const Token name = consume(IDENTIFIER, "Expect " + kind + " name.");
-    consume(LEFT_PAREN, "Expect '(' after " + kind + " name.");
+int Parser::function(const char* kind) {
+    const Token& name = consume(IDENTIFIER, {"Expect ", kind, " name."});
+    consume(LEFT_PAREN, {"Expect '(' after ", kind, " name."});
 
-    std::vector<int> parameters;
+    const size_t mark = pending.size();
     if (!check(RIGHT_PAREN)) {
         do {
-            if (parameters.size() >= 255) {
+            if (pending.size() - mark >= 255) {
                 error(peek(), "Can't have more than 255 parameters.");
             }
-            const Token paramName = consume(IDENTIFIER, "Expect parameter name.");
-            int paramNode = arena.addNode(NodeType::VAR_EXPR, paramName, std::monostate{},
-                {});
-            parameters.push_back(paramNode);
+            const Token& paramName = consume(IDENTIFIER, "Expect parameter name.");
+            pending.push_back(addNode(NodeType::VAR_EXPR, paramName, {}));
         } while (match({COMMA}));
     }
     consume(RIGHT_PAREN, "Expect ')' after parameters.");
 
-    consume(LEFT_BRACE, "Expect '{' before " + kind + " body.");
-    const std::vector<int> bodyStmts = block();
-    const int bodyNode = arena.addNode(NodeType::STMT_BLOCK, previous(), std::monostate{}, bodyStmts);
+    consume(LEFT_BRACE, {"Expect '{' before ", kind, " body."});
+    const size_t bodyMark = block();
+    pending.push_back(addNode(NodeType::STMT_BLOCK, previous(), bodyMark));
 
-    std::vector<int> children;
-    children.insert(children.end(), parameters.begin(), parameters.end());
-    children.push_back(bodyNode);
-
-    return arena.addNode(NodeType::STMT_FUNCTION, name, std::monostate{}, children);
+    return addNode(NodeType::STMT_FUNCTION, name, mark);
 }
 
-int Parser::consumeBlock(const std::string& errorMessage) {
+int Parser::consumeBlock(const char* errorMessage) {
     if (match({LEFT_BRACE})) {
-        const std::vector<int> statements = block();
-        return arena.addNode(NodeType::STMT_BLOCK, previous(), std::monostate{},
-            statements);
+        const size_t mark = block();
+        return addNode(NodeType::STMT_BLOCK, previous(), mark);
     }
     throw error(peek(), errorMessage);
 }
 
-int Parser::consumeCondition(const std::string& name) {
-    consume(LEFT_PAREN, "Expect '(' after '" + name + "' statement.");
+int Parser::consumeCondition(const char* name) {
+    consume(LEFT_PAREN, {"Expect '(' after '", name, "' statement."});
     const int condition = expression();
-    consume(RIGHT_PAREN, "Expect ')' after " + name + " condition.");
+    consume(RIGHT_PAREN, {"Expect ')' after ", name, " condition."});
     return condition;
 }
 
@@ -157,27 +155,25 @@ int Parser::forStatement() {
     int body = statement();
 
     if (increment != -1) {
-        int incrStmt = arena.addNode(NodeType::STMT_EXPR, previous(), std::monostate{},
-        {increment});
+        int incrStmt = addNode(NodeType::STMT_EXPR, previous(), {increment});
 
-        body = arena.addNode(NodeType::STMT_BLOCK, previous(), std::monostate{},
-            {body, incrStmt});
+        body = addNode(NodeType::STMT_BLOCK, previous(), {body, incrStmt});
     }
 
     if (condition == -1) {
-        const Token trueTok(TRUE, "true", true, 0);
-        condition = arena.addNode(NodeType::LITERAL, trueTok, true, {});
+        const Token trueTok(TRUE, 0, 0, 0);
+        condition = arena.addLiteral(trueTok, true);
     }
-    body = arena.addNode(NodeType::STMT_WHILE, previous(), std::monostate{}, {condition, body});
+    body = addNode(NodeType::STMT_WHILE, previous(), {condition, body});
     if (initializer != -1) {
-         body = arena.addNode(NodeType::STMT_BLOCK, previous(), std::monostate{}, {initializer, body});
+         body = addNode(NodeType::STMT_BLOCK, previous(), {initializer, body});
     }
 
     return body;
 }
 
 int Parser::returnStatement() {
-    const Token keyword = previous();
+    const Token& keyword = previous();
     int value = -1;
     if (!check(SEMICOLON)) {
         value = expression();
@@ -185,15 +181,14 @@ int Parser::returnStatement() {
 
     consume(SEMICOLON, "Expect ';' after return value.");
 
-    return arena.addNode(NodeType::STMT_RETURN, keyword, std::monostate{}, {value});
+    return addNode(NodeType::STMT_RETURN, keyword, {value});
 }
 
 int Parser::whileStatement() {
     int condition = consumeCondition("while");
     int body = statement();
 
-    return arena.addNode(NodeType::STMT_WHILE, previous(), std::monostate{},
-        {condition, body});
+    return addNode(NodeType::STMT_WHILE, previous(), {condition, body});
 }
 
 int Parser::ifStatement() {
@@ -206,22 +201,21 @@ int Parser::ifStatement() {
         elseBranch = statement();
     }
 
-    return arena.addNode(NodeType::STMT_IF, previous(), std::monostate{},
-        {condition, thenBranch, elseBranch});
+    return addNode(NodeType::STMT_IF, previous(), {condition, thenBranch, elseBranch});
 }
 
 int Parser::echoStatement() {
     int expr = expression();
     consume(SEMICOLON, "Expected ';' after value");
 
-    return arena.addNode(NodeType::STMT_ECHO, previous(), previous().literal, {expr});
+    return addNode(NodeType::STMT_ECHO, previous(), {expr});
 }
 
 int Parser::expressionStatement() {
     int expr = expression();
     consume(SEMICOLON, "Expected ';' after value");
 
-    return arena.addNode(NodeType::STMT_EXPR, previous(), previous().literal, {expr});
+    return addNode(NodeType::STMT_EXPR, previous(), {expr});
 }
 
 int Parser::expression() {
@@ -229,19 +223,23 @@ int Parser::expression() {
 }
 
 int Parser::assignment() {
+    const int start = current;
     const int expr = logical_or();
 
     if (match({EQUAL})) {
-        const Token equals = previous();
+        const Token& equals = previous();
 
         int value = assignment();
 
-        const Node& leftNode = arena.get(expr);
-
-        if (leftNode.type == NodeType::VAR_EXPR) {
-            const Token name= leftNode.op;
-
-            return arena.addNode(NodeType::ASSIGN, name, std::monostate{}, {value});
+        // A VAR_EXPR target is always the lone identifier it started at.
+        const Node target = arena.get(expr);
+        if (target.type() == NodeType::VAR_EXPR) {
+            return addNode(NodeType::ASSIGN, tokens[start], {value});
+        }
+        if (target.type() == NodeType::INDEX_GET) {
+            const int object = target.child(0);
+            const int index = target.child(1);
+            return addNode(NodeType::INDEX_SET, equals, {object, index, value});
         }
 
         error(equals, "Invalid assignment target.");
@@ -254,10 +252,9 @@ int Parser::logical_or() {
     int left = logical_and();
 
     while (match({OR})) {
-        const Token op = previous();
+        const Token& op = previous();
         int right = logical_and();
-        left = arena.addNode(NodeType::LOGICAL, op, std::monostate{},
-            {left, right});
+        left = addNode(NodeType::LOGICAL, op, {left, right});
     }
 
     return left;
@@ -267,10 +264,9 @@ int Parser::logical_and() {
     int left = equality();
 
     while (match({AND})) {
-        const Token op = previous();
+        const Token& op = previous();
         int right = equality();
-        left = arena.addNode(NodeType::LOGICAL, op, std::monostate{},
-            {left, right});
+        left = addNode(NodeType::LOGICAL, op, {left, right});
     }
 
     return left;
@@ -280,11 +276,10 @@ int Parser::equality() {
     int leftIndex = comparison();
 
     while (match({BANG_EQUAL, EQUAL_EQUAL})) {
-        const Token op = previous();
+        const Token& op = previous();
         const int rightIndex = comparison();
 
-        leftIndex = arena.addNode(NodeType::BINARY, op, std::monostate{},
-            {leftIndex, rightIndex});
+        leftIndex = addNode(NodeType::BINARY, op, {leftIndex, rightIndex});
     }
 
     return leftIndex;
@@ -294,11 +289,10 @@ int Parser::comparison() {
     int leftIndex = term();
 
     while (match({GREATER, GREATER_EQUAL, LESS, LESS_EQUAL})) {
-        const Token op = previous();
+        const Token& op = previous();
         const int rightIndex = term();
 
-        leftIndex = arena.addNode(NodeType::BINARY, op, std::monostate{},
-            {leftIndex, rightIndex});
+        leftIndex = addNode(NodeType::BINARY, op, {leftIndex, rightIndex});
     }
 
     return leftIndex;
@@ -308,11 +302,10 @@ int Parser::term() {
     int leftIndex = factor();
 
     while (match({PLUS, MINUS})) {
-        const Token op = previous();
+        const Token& op = previous();
         const int rightIndex = factor();
 
-        leftIndex = arena.addNode(NodeType::BINARY, op, std::monostate{},
-            {leftIndex, rightIndex});
+        leftIndex = addNode(NodeType::BINARY, op, {leftIndex, rightIndex});
     }
 
     return leftIndex;
@@ -322,11 +315,10 @@ int Parser::factor() {
     int leftIndex = unary();
 
     while (match({SLASH, STAR})) {
-        const Token op = previous();
+        const Token& op = previous();
         const int rightIndex = unary();
 
-        leftIndex = arena.addNode(NodeType::BINARY, op, std::monostate{},
-            {leftIndex, rightIndex});
+        leftIndex = addNode(NodeType::BINARY, op, {leftIndex, rightIndex});
     }
 
     return leftIndex;
@@ -334,11 +326,10 @@ int Parser::factor() {
 
 int Parser::unary() {
     if (match({BANG, MINUS})) {
-        const Token op = previous();
+        const Token& op = previous();
         const int rightIndex = unary();
 
-        return arena.addNode(NodeType::UNARY, op, std::monostate{},
-            {rightIndex});
+        return addNode(NodeType::UNARY, op, {rightIndex});
     }
 
     return call();
@@ -362,87 +353,105 @@ int Parser::call() {
 
 int Parser::finishIndex(int callee) {
     int index = expression();
-    const Token bracket = consume(RIGHT_BRACKET, "Expect ']' after index.");
-    return arena.addNode(NodeType::INDEX_GET, bracket, std::monostate{}, {callee, index});
+    const Token& bracket = consume(RIGHT_BRACKET, "Expect ']' after index.");
+    return addNode(NodeType::INDEX_GET, bracket, {callee, index});
 }
 
 int Parser::finishCall(const int callee) {
-    std::vector<int> arguments;
+    const size_t mark = pending.size();
+    pending.push_back(callee);
     if (!check(RIGHT_PAREN)) {
         do {
-            if (arguments.size() >= 255) {
+            if (pending.size() - mark > 255) {
                 error(peek(), "Can't have more than 255 arguments.");
             }
-            arguments.push_back(expression());
+            pending.push_back(expression());
         } while (match({COMMA}));
     }
 
-    const Token paren = consume(RIGHT_PAREN, "Expect ')' after arguments.");
-
-    std::vector<int> children;
-    children.push_back(callee);
-    children.insert(children.end(), arguments.begin(), arguments.end());
+    const Token& paren = consume(RIGHT_PAREN, "Expect ')' after arguments.");
 
-    return arena.addNode(NodeType::CALL, paren, std::monostate{}, children);
+    return addNode(NodeType::CALL, paren, mark);
 }
 
 int Parser::array() {
-    const Token bracket = previous();
-    std::vector<int> elements;
+    const Token& bracket = previous();
+    const size_t mark = pending.size();
     if (!check(RIGHT_BRACKET)) {
         do {
-            elements.push_back(expression());
+            pending.push_back(expression());
         } while (match({COMMA}));
     }
     consume(RIGHT_BRACKET, "Expect ']' after array elements.");
-    return arena.addNode(NodeType::ARRAY, bracket, std::monostate{}, elements);
+    return addNode(NodeType::ARRAY, bracket, mark);
+}
+
+int Parser::map() {
+    const Token& brace = previous();
+    const size_t mark = pending.size();
+    if (!check(RIGHT_BRACE)) {
+        do {
+            pending.push_back(expression());
+            consume(COLON, "Expect ':' after map key.");
+            pending.push_back(expression());
+        } while (match({COMMA}));
+    }
+    consume(RIGHT_BRACE, "Expect '}' after map entries.");
+    return addNode(NodeType::MAP, brace, mark);
 }
 
 int Parser::primary() {
     if (match({FALSE}))
-        return arena.addNode(NodeType::LITERAL, previous(), false, {});
+        return arena.addLiteral(previous(), false);
     if (match({TRUE}))
-        return arena.addNode(NodeType::LITERAL, previous(), true, {});
+        return arena.addLiteral(previous(), true);
     if (match({TOK_NULL}))
-        return arena.addNode(NodeType::LITERAL, previous(), std::monostate{}, {});
+        return arena.addLiteral(previous(), Value());
 
     if (match({NUMBER, STRING})) {
-        return arena.addNode(NodeType::LITERAL, previous(), previous().literal, {});
+        return arena.addLiteral(previous(), Scanner::literal(previous(), source));
     }
 
     if (match({LEFT_BRACKET})) {
         return array();
     }
 
+    // Only in an expression: a statement starting with '{' is a block.
+    if (match({LEFT_BRACE})) {
+        return map();
+    }
+
     if (match({LEFT_PAREN})) {
         const int expr = expression();
         consume(RIGHT_PAREN, "Expect ')' after expression.");
 
-        return arena.addNode(NodeType::GROUPING, previous(), std::monostate{}, {expr});
+        return addNode(NodeType::GROUPING, previous(), {expr});
     }
 
     if (match({DOLLAR})) {
-        const Token varName = consume(IDENTIFIER, "Expect variable name after $.");
+        const Token& varName = consume(IDENTIFIER, "Expect variable name after $.");
 
-        int argNode = arena.addNode(NodeType::LITERAL, varName, varName.lexeme, {});
+        int argNode = arena.addLiteral(varName, std::string(varName.lexeme(source)));
 
-        const Token envToken(IDENTIFIER, "env", std::monostate{}, varName.line);
-        int funcNode = arena.addNode(NodeType::VAR_EXPR, envToken, std::monostate{}, {});
+        int funcNode = arena.addNode(NodeType::VAR_EXPR, varName, "env", {});
 
-        return arena.addNode(NodeType::CALL, previous(), std::monostate{}, {funcNode, argNode});
+        return addNode(NodeType::CALL, previous(), {funcNode, argNode});
     }
 
     if (match({IDENTIFIER})) {
-        return arena.addNode(NodeType::VAR_EXPR, previous(), previous().literal, {});
+        return addNode(NodeType::VAR_EXPR, previous(), {});
     }
 
     throw error(peek(), "Expect expression.");
 }
 
 bool Parser::match(const std::initializer_list<TokenType> types) {
+    const TokenType next = peek().type;
+    if (next == EOF_TOKEN)
+        return false;
     for (const TokenType type : types) {
-        if (check(type)) {
-            advance();
+        if (type == next) {
+            current++;
             return true;
         }
     }
@@ -455,7 +464,7 @@ bool Parser::check(const TokenType type) const {
     return peek().type == type;
 }
 
-Token Parser::advance() {
+const Token& Parser::advance() {
     if (!isAtEnd())
         current++;
     return previous();
@@ -465,24 +474,43 @@ bool Parser::isAtEnd() const {
     return peek().type == EOF_TOKEN;
 }
 
-Token Parser::peek() const {
+const Token& Parser::peek() const {
     return tokens[current];
 }
 
-Token Parser::previous() const {
+const Token& Parser::previous() const {
     return tokens[current - 1];
 }
 
-Token Parser::consume(TokenType type, const std::string& message) {
+const Token& Parser::consume(const TokenType type, const char* message) {
     if (check(type))
         return advance();
 
     throw error(peek(), message);
 }
 
-Parser::ParseError Parser::error(const Token& token, const std::string& message) {
-    std::cerr << "[line " << token.line << "] Error at '" << token.lexeme << "': " << message << std::endl;
-    Core::hadError = true;
+const Token& Parser::consume(const TokenType type, const std::initializer_list<std::string_view> message) {
+    if (check(type))
+        return advance();
+
+    std::string text;
+    for (const std::string_view part : message) text += part;
+    throw error(peek(), text);
+}
+
+int Parser::addNode(const NodeType type, const Token& op, const std::initializer_list<int> children) {
+    return arena.addNode(type, op, op.lexeme(source), children);
+}
+
+int Parser::addNode(const NodeType type, const Token& op, const size_t mark) {
+    const Children children(pending.data() + mark, static_cast<uint32_t>(pending.size() - mark));
+    const int index = arena.addNode(type, op, op.lexeme(source), children);
+    pending.resize(mark);
+    return index;
+}
+
+Parser::ParseError Parser::error(const Token& token, const std::string_view message) const {
+    core.report(token.line, " at '" + std::string(token.lexeme(source)) + "'", std::string(message));
     return {};
 }
 
@@ -5,6 +5,7 @@
 #ifndef CIPR_PARSER_H
 #define CIPR_PARSER_H
 
+#include <string_view>
 #include <vector>
 #include <initializer_list>
 #include <stdexcept>
@@ -12,6 +13,8 @@
 #include "Token/Token.h"
 #include "AST/Node.h"
 
+class Core;
+
 class Parser {
 public:
     class ParseError final : public std::runtime_error {
@@ -19,23 +22,30 @@ public:
         ParseError() : std::runtime_error("") {}
     };
 
-    Parser(const std::vector<Token>& tokens, Arena& arena)
-        : tokens(tokens), arena(arena) {}
+    // `tokens` were scanned from `source`, which resolves their lexemes.
+    // Errors are reported to `core`.
+    Parser(const std::string_view source, const std::vector<Token>& tokens, Arena& arena, Core& core)
+        : source(source), tokens(tokens), arena(arena), core(core) {}
 
     int parse();
 
 private:
+    const std::string_view source;
     const std::vector<Token>& tokens;
     Arena& arena;
+    Core& core;
     int current = 0;
+    // Child lists being built. A list starts at a mark and is popped when its
+    // node is made, so nested lists stack on top of the ones around them.
+    std::vector<int> pending;
 
     int declaration();
     int varDeclaration();
-    int function(const std::string& kind);
+    int function(const char* kind);
 
-    int consumeCondition(const std::string& name);
-    std::vector<int> block();
-    int consumeBlock(const std::string& errorMessage);
+    int consumeCondition(const char* name);
+    size_t block();
+    int consumeBlock(const char* errorMessage);
 
     int ifStatement();
     int whileStatement();
@@ -58,20 +68,27 @@ private:
     int finishCall(int callee);
     int finishIndex(int callee);
     int array();
+    int map();
     int primary();
 
     void synchronize();
 
     bool match(std::initializer_list<TokenType> types);
     bool check(TokenType type) const;
-    Token advance();
+    const Token& advance();
     bool isAtEnd() const;
-    Token peek() const;
-    Token previous() const;
+    const Token& peek() const;
+    const Token& previous() const;
+
+    const Token& consume(TokenType type, const char* message);
+    // The message parts are only joined if the token is missing.
+    const Token& consume(TokenType type, std::initializer_list<std::string_view> message);
 
-    Token consume(TokenType type, const std::string& message);
+    int addNode(NodeType type, const Token& op, std::initializer_list<int> children);
+    // Makes a node of the pending children from `mark` on and pops them.
+    int addNode(NodeType type, const Token& op, size_t mark);
 
-    static ParseError error(const Token& token, const std::string& message);
+    ParseError error(const Token& token, std::string_view message) const;
 };
 
 #endif //CIPR_PARSER_H
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "Resolver.h"
+
+#include <algorithm>
+
+void Resolver::resolve(const int rootIndex) {
+    frameTop = 0;
+    frameSize = 0;
+    statement(rootIndex);
+    arena.get(rootIndex).setFrameSize(frameSize);
+}
+
+void Resolver::statement(const int index) {
+    if (index == -1)
+        return;
+
+    switch (Node node = arena.get(index); node.type()) {
+        case NodeType::STMT_LIST:
+            for (const int childIndex : node.children()) {
+                statement(childIndex);
+            }
+            break;
+        case NodeType::STMT_BLOCK:
+            block(node);
+            break;
+        case NodeType::STMT_VAR_DECL:
+            expression(node.child(0));
+            declare(node);
+            break;
+        case NodeType::STMT_FUNCTION:
+            declare(node);
+            function(node);
+            break;
+        case NodeType::STMT_IF:
+            expression(node.child(0));
+            statement(node.child(1));
+            statement(node.child(2));
+            break;
+        case NodeType::STMT_WHILE:
+            expression(node.child(0));
+            statement(node.child(1));
+            break;
+        case NodeType::STMT_RETURN:
+            node.setTailCall(functionDepth > 0 && node.child(0) != -1 &&
+                arena.get(node.child(0)).type() == NodeType::CALL);
+            expression(node.child(0));
+            break;
+        case NodeType::STMT_ECHO:
+        case NodeType::STMT_EXPR:
+            for (const int childIndex : node.children()) {
+                expression(childIndex);
+            }
+            break;
+        default:
+            expression(index);
+            break;
+    }
+}
+
+void Resolver::expression(const int index) {
+    if (index == -1)
+        return;
+
+    switch (Node node = arena.get(index); node.type()) {
+        case NodeType::VAR_EXPR:
+            resolveLocal(node);
+            break;
+        case NodeType::ASSIGN:
+            expression(node.child(0));
+            resolveLocal(node);
+            break;
+        default:
+            for (const int childIndex : node.children()) {
+                expression(childIndex);
+            }
+            break;
+    }
+}
+
+void Resolver::block(Node& node) {
+    Scope& scope = beginScope(declaresFunction(node.children()));
+    declareAll(scope, node.children());
+    node.setSlotCount(endDeclarations(scope));
+
+    for (const int childIndex : node.children()) {
+        statement(childIndex);
+    }
+
+    endScope();
+}
+
+void Resolver::function(Node& node) {
+    // Parameters and the body's own declarations share one scope, as
+    // Function::call runs the body directly in the parameter scope.
+    Node body = arena.get(node.children().back());
+    const int enclosingFrameTop = frameTop;
+    const int enclosingFrameSize = frameSize;
+    frameTop = 0;
+    frameSize = 0;
+    functionDepth++;
+
+    Scope& scope = beginScope(declaresFunction(body.children()));
+    for (size_t i = 0; i + 1 < node.children().size(); ++i) {
+        const Node param = arena.get(node.child(i));
+        scope.bindings.try_emplace(param.lexeme(),
+            Binding{static_cast<int>(scope.bindings.size()), true, false});
+    }
+    declareAll(scope, body.children());
+    body.setSlotCount(endDeclarations(scope));
+
+    for (size_t i = 0; i + 1 < node.children().size(); ++i) {
+        Node param = arena.get(node.child(i));
+        resolveLocal(param);
+    }
+
+    for (const int childIndex : body.children()) {
+        statement(childIndex);
+    }
+
+    endScope();
+    functionDepth--;
+    node.setFrameSize(frameSize);
+    frameTop = enclosingFrameTop;
+    frameSize = enclosingFrameSize;
+}
+
+Resolver::Scope& Resolver::beginScope(const bool captured) {
+    Scope& scope = scopes.emplace_back();
+    scope.function = functionDepth;
+    scope.captured = captured;
+    scope.frameStart = frameTop;
+    return scope;
+}
+
+void Resolver::declareAll(Scope& scope, const Children statements) {
+    // Declarations only appear as direct children of a block, so every slot
+    // the scope needs is known before its first statement runs.
+    for (const int childIndex : statements) {
+        if (childIndex == -1) continue;
+        const Node child = arena.get(childIndex);
+        if (child.type() == NodeType::STMT_VAR_DECL || child.type() == NodeType::STMT_FUNCTION) {
+            const auto [it, added] = scope.bindings.try_emplace(child.lexeme(),
+                Binding{static_cast<int>(scope.bindings.size()), false, false});
+            it->second.function = it->second.function || child.type() == NodeType::STMT_FUNCTION;
+        }
+    }
+}
+
+int Resolver::endDeclarations(Scope& scope) {
+    const int count = static_cast<int>(scope.bindings.size());
+    if (scope.captured) {
+        return count;
+    }
+
+    // Uncaptured locals take the next free slots of the call frame.
+    for (auto& [name, binding] : scope.bindings) {
+        binding.slot += frameTop;
+    }
+    frameTop += count;
+    frameSize = std::max(frameSize, frameTop);
+    return 0;
+}
+
+void Resolver::endScope() {
+    frameTop = scopes.back().frameStart;
+    scopes.pop_back();
+}
+
+void Resolver::declare(Node& node) {
+    if (scopes.empty())
+        return;
+
+    Scope& scope = scopes.back();
+    Binding& binding = scope.bindings.at(node.lexeme());
+    binding.declared = true;
+    node.bind(scope.captured ? 0 : -1, binding.slot);
+}
+
+void Resolver::resolveLocal(Node& node) const {
+    int depth = 0;
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        // Only captured scopes that declare something get an Environment.
+        const bool hasEnvironment = scope->captured && !scope->bindings.empty();
+
+        const auto it = scope->bindings.find(node.lexeme());
+        // Code only sees names declared above it, so a nested function still
+        // reads a global that a later `let` shadows. It may call functions
+        // declared further down, though, for mutual recursion.
+        if (it != scope->bindings.end() &&
+            (it->second.declared || (it->second.function && scope->function < functionDepth))) {
+            node.bind(hasEnvironment ? depth : -1, it->second.slot);
+            return;
+        }
+
+        if (hasEnvironment) depth++;
+    }
+}
+
+bool Resolver::declaresFunction(const Children statements) {
+    for (const int childIndex : statements) {
+        if (declaresFunction(childIndex)) return true;
+    }
+    return false;
+}
+
+bool Resolver::declaresFunction(const int index) {
+    if (index == -1)
+        return false;
+
+    switch (const Node node = arena.get(index); node.type()) {
+        case NodeType::STMT_FUNCTION:
+            return true;
+        case NodeType::STMT_BLOCK:
+            return declaresFunction(node.children());
+        case NodeType::STMT_IF:
+            return declaresFunction(node.child(1)) || declaresFunction(node.child(2));
+        case NodeType::STMT_WHILE:
+            return declaresFunction(node.child(1));
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef CIPR_RESOLVER_H
+#define CIPR_RESOLVER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AST/Node.h"
+
+// Runs between Parser::parse and Interpreter::interpret, binding each local
+// variable reference to its slot in the Arena. Scopes that a function is
+// declared inside get a heap Environment a closure can hold on to; every
+// other local lives in the interpreter's call frame. Names no enclosing
+// scope declares are left for the global Environment to look up by name.
+class Resolver {
+public:
+    explicit Resolver(Arena& arena) : arena(arena) {}
+
+    void resolve(int rootIndex);
+
+private:
+    struct Binding {
+        int slot;
+        bool declared;
+        // Declared by a function, which nested functions may call before
+        // its declaration is reached.
+        bool function;
+    };
+
+    struct Scope {
+        std::unordered_map<std::string, Binding> bindings;
+        int function;
+        bool captured;
+        int frameStart;
+    };
+
+    Arena& arena;
+    std::vector<Scope> scopes;
+    int functionDepth = 0;
+    int frameTop = 0;
+    int frameSize = 0;
+
+    void statement(int index);
+    void expression(int index);
+    void block(Node& node);
+    void function(Node& node);
+
+    Scope& beginScope(bool captured);
+    void declareAll(Scope& scope, Children statements);
+    int endDeclarations(Scope& scope);
+    void endScope();
+    void declare(Node& node);
+    void resolveLocal(Node& node) const;
+
+    bool declaresFunction(Children statements);
+    bool declaresFunction(int index);
+};
+
+#endif //CIPR_RESOLVER_H
@@ -1,17 +1,79 @@
 #include "Scanner.h"
-#include <map>
-#include <utility>
+#include <charconv>
 #include "Core/Core.h"
 
-Scanner::Scanner(std::string source) : source_(std::move(source)) {}
+namespace {
+    // Keywords are told apart by length and first letter, which leaves at
+    // most one candidate (two for "else"/"echo" and "this"/"true") to compare.
+    TokenType keywordType(const std::string_view text) {
+        const auto is = [text](const std::string_view word, const TokenType type) {
+            return text == word ? type : IDENTIFIER;
+        };
+
+        switch (text.size()) {
+            case 2:
+                switch (text[0]) {
+                    case 'f': return is("fn", FN);
+                    case 'i': return is("if", IF);
+                    case 'o': return is("or", OR);
+                    default: break;
+                }
+                break;
+            case 3:
+                switch (text[0]) {
+                    case 'a': return is("and", AND);
+                    case 'f': return is("for", FOR);
+                    case 'l': return is("let", LET);
+                    default: break;
+                }
+                break;
+            case 4:
+                switch (text[0]) {
+                    case 'e': return text[1] == 'l' ? is("else", ELSE) : is("echo", ECHO);
+                    case 'n': return is("null", TOK_NULL);
+                    case 't': return text[1] == 'h' ? is("this", THIS) : is("true", TRUE);
+                    default: break;
+                }
+                break;
+            case 5:
+                switch (text[0]) {
+                    case 'c': return is("class", CLASS);
+                    case 'f': return is("false", FALSE);
+                    case 's': return is("super", SUPER);
+                    case 'w': return is("while", WHILE);
+                    default: break;
+                }
+                break;
+            case 6:
+                return is("return", RETURN);
+            default:
+                break;
+        }
+        return IDENTIFIER;
+    }
+
+    // Short literals are interned, so equal ones compare by pointer.
+    Value stringValue(const std::string_view text) {
+        if (text.size() <= String::MAX_INTERNED_LENGTH) {
+            return Value(String::intern(text));
+        }
+        return Value(std::string(text));
+    }
+}
+
+Scanner::Scanner(const std::string_view source, Core& core) : source_(source), core(core) {}
 
 std::vector<Token> Scanner::scanTokens() {
+    // Real scripts average over four characters a token. A large reservation
+    // is cheap: pages the vector never writes are never faulted in.
+    tokens.reserve(source_.size() / 2 + 1);
+
     while (!isAtEnd()) {
         start = current;
         scanToken();
     }
 
-    tokens.emplace_back(EOF_TOKEN, "", std::monostate{}, line);
+    tokens.emplace_back(EOF_TOKEN, static_cast<uint32_t>(source_.size()), 0, line);
     return tokens;
 }
 
@@ -25,6 +87,7 @@ void Scanner::scanToken() {
         case '[': addToken(LEFT_BRACKET); break;
         case ']': addToken(RIGHT_BRACKET); break;
         case '$': addToken(DOLLAR); break;
+        case ':': addToken(COLON); break;
         case ',': addToken(COMMA); break;
         case '.': addToken(DOT); break;
         case '-': addToken(MINUS); break;
@@ -74,7 +137,7 @@ void Scanner::scanToken() {
             } else if (isAlpha(c)) {
                 identifier();
             } else {
-                Core::error(line, "Unexpected character.");
+                core.error(line, "Unexpected character.");
             }
             break;
     }
@@ -113,64 +176,34 @@ void Scanner::identifier() {
     while (isAlphaNumeric(peek()))
         advance();
 
-    const std::string text = source_.substr(start, current - start);
-    static const std::map<std::string, TokenType> keywords = {
-        {"and", AND},
-        {"class", CLASS},
-        {"else", ELSE},
-        {"false", FALSE},
-        {"fn", FN},
-        {"for", FOR},
-        {"if", IF},
-        {"null", TOK_NULL},
-        {"or", OR},
-        {"echo", ECHO},
-        {"return", RETURN},
-        {"super", SUPER},
-        {"this", THIS},
-        {"true", TRUE},
-        {"let", LET},
-        {"while", WHILE}
-    };
-
-    const auto it = keywords.find(text);
-    TokenType type = it != keywords.end() ? it->second : IDENTIFIER;
-    addToken(type);
+    const std::string_view text = source_.substr(start, current - start);
+    if (const TokenType type = keywordType(text); type != IDENTIFIER) {
+        addToken(type);
+        return;
+    }
+
+    // The name is interned by the Arena when a node is made from it.
+    addToken(IDENTIFIER);
 }
 
-void Scanner::string(char delimiter) {
-    std::string value;
+void Scanner::string(const char delimiter) {
     while (peek() != delimiter && !isAtEnd()) {
         if (peek() == '\n')
             line++;
-        
-        if (peek() == '\\') {
-            advance(); // consume '\'
-            switch (peek()) {
-                case 'n': value += '\n'; break;
-                case 't': value += '\t'; break;
-                case 'r': value += '\r'; break;
-                case '\\': value += '\\'; break;
-                case '"': value += '"'; break;
-                case '\'': value += '\''; break;
-                default: 
-                    value += '\\';
-                    value += peek();
-                    break;
-            }
-        } else {
-            value += peek();
-        }
+
+        // An escaped character never ends the string; literal() decodes it.
+        if (peek() == '\\')
+            advance();
         advance();
     }
 
     if (isAtEnd()) {
-        Core::error(line, "Unterminated string.");
+        core.error(line, "Unterminated string.");
         return;
     }
 
     advance(); // The closing delimiter
-    addToken(STRING, value);
+    addToken(STRING);
 }
 
 void Scanner::number() {
@@ -184,7 +217,46 @@ void Scanner::number() {
             advance();
     }
 
-    addToken(NUMBER, std::stod(source_.substr(start, current - start)));
+    addToken(NUMBER);
+}
+
+Value Scanner::literal(const Token& token, const std::string_view source) {
+    const std::string_view lexeme = token.lexeme(source);
+    if (token.type == NUMBER) {
+        double value = 0;
+        std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+        return value;
+    }
+
+    // Strip the delimiters. Text without escapes is used as it is; otherwise
+    // it is copied a run at a time between them.
+    const std::string_view text = lexeme.substr(1, lexeme.size() - 2);
+    size_t escape = text.find('\\');
+    if (escape == std::string_view::npos) {
+        return stringValue(text);
+    }
+
+    std::string value;
+    size_t run = 0;
+    while (escape != std::string_view::npos && escape + 1 < text.size()) {
+        value.append(text.substr(run, escape - run));
+        switch (const char c = text[escape + 1]) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            case '\\': value += '\\'; break;
+            case '"': value += '"'; break;
+            case '\'': value += '\''; break;
+            default:
+                value += '\\';
+                value += c;
+                break;
+        }
+        run = escape + 2;
+        escape = text.find('\\', run);
+    }
+    value.append(text.substr(run));
+    return value;
 }
 
 bool Scanner::isDigit(const char c) {
@@ -200,10 +272,5 @@ bool Scanner::isAlphaNumeric(const char c) {
 }
 
 void Scanner::addToken(const TokenType type) {
-    addToken(type, std::monostate{});
-}
-
-void Scanner::addToken(const TokenType type, const Literal& literal) {
-    const std::string text = source_.substr(start, current - start);
-    tokens.emplace_back(type, text, literal, line);
+    tokens.emplace_back(type, start, current - start, line);
 }
\ No newline at end of file
@@ -4,22 +4,31 @@
 
 #ifndef CIPR_SCANNER_H
 #define CIPR_SCANNER_H
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 #include "../Token/Token.h"
+#include "Value/Value.h"
 
+class Core;
+
+// Tokens view `source` rather than copying their text, so the caller keeps
+// the source alive for as long as it uses them.
 class Scanner {
 public:
-    explicit Scanner(std::string  source);
+    // Errors are reported to `core`.
+    Scanner(std::string_view source, Core& core);
     std::vector<Token> scanTokens();
 
+    // The value a NUMBER or STRING token of `source` stands for.
+    static Value literal(const Token& token, std::string_view source);
+
 private:
-    const std::string source_;
+    const std::string_view source_;
+    Core& core;
     std::vector<Token> tokens;
-    static const std::unordered_map<std::string, TokenType> keywords;
-    int start = 0;
-    int current = 0;
+    uint32_t start = 0;
+    uint32_t current = 0;
     int line = 1;
 
     bool isAtEnd() const;
@@ -30,8 +39,6 @@ private:
 
     void addToken(TokenType type);
 
-    void addToken(TokenType type, const Literal& literal);
-
     bool match(char expected);
 
     char peek() const;
@@ -51,4 +58,4 @@ private:
     void identifier();
 };
 
-#endif //CIPR_SCANNER_H
\ No newline at end of file
+#endif //CIPR_SCANNER_H
@@ -3,12 +3,11 @@
 //
 
 #include "Token.h"
-#include <sstream>
 
 std::string tokenTypeName(const TokenType type) {
     static const char* names[] = {
-        "LEFT_PAREN", "RIGHT_PAREN", "LEFT_BRACE", "RIGHT_BRACE", "DOLLAR",
-        "COMMA", "DOT", "MINUS", "PLUS", "SEMICOLON", "SLASH", "STAR",
+        "LEFT_PAREN", "RIGHT_PAREN", "LEFT_BRACE", "RIGHT_BRACE", "LEFT_BRACKET", "RIGHT_BRACKET",
+        "COMMA", "DOT", "MINUS", "PLUS", "SEMICOLON", "SLASH", "STAR", "DOLLAR", "COLON",
         "BANG", "BANG_EQUAL", "EQUAL", "EQUAL_EQUAL",
         "GREATER", "GREATER_EQUAL", "LESS", "LESS_EQUAL",
         "IDENTIFIER", "STRING", "NUMBER",
@@ -18,15 +17,6 @@ std::string tokenTypeName(const TokenType type) {
     };
     return names[type];
 }
-std::string Token::toString() const {
-    std::string literal_str;
-
-    if (std::holds_alternative<double>(literal)) {
-        literal_str = std::to_string(std::get<double>(literal));
-    } else if (std::holds_alternative<std::string>(literal)) {
-        literal_str = std::get<std::string>(literal);
-    } else {
-        literal_str = "null";
-    }
-    return tokenTypeName(type) + " " + lexeme + " " + literal_str;
-}
\ No newline at end of file
+std::string Token::toString(const std::string_view source) const {
+    return tokenTypeName(type) + " " + std::string(lexeme(source));
+}
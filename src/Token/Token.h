@@ -4,19 +4,14 @@
 
 #ifndef CIPR_TOKEN_H
 #define CIPR_TOKEN_H
+#include <cstdint>
 #include <string>
-#include <utility>
-#include <variant>
-#include <memory>
-#include <vector>
+#include <string_view>
 
-struct Callable;
-struct LiteralVector;
-
-enum TokenType {
+enum TokenType : uint8_t {
     // Single-character
     LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE, LEFT_BRACKET, RIGHT_BRACKET,
-    COMMA, DOT, MINUS, PLUS, SEMICOLON, SLASH, STAR, DOLLAR,
+    COMMA, DOT, MINUS, PLUS, SEMICOLON, SLASH, STAR, DOLLAR, COLON,
 
     // One or two character
     BANG, BANG_EQUAL, EQUAL, EQUAL_EQUAL,
@@ -32,29 +27,22 @@ enum TokenType {
     EOF_TOKEN
 };
 
-using Literal = std::variant<
-    std::monostate,
-    std::string,
-    double,
-    bool,
-    std::shared_ptr<Callable>,
-    std::shared_ptr<LiteralVector>
->;
-
-struct LiteralVector {
-    std::vector<Literal> elements;
-};
-
+// Where a token sits in the source text, which must outlive it. NUMBER and
+// STRING tokens are decoded into values by Scanner::literal.
 struct Token {
-    const TokenType type;
-    const std::string lexeme;
-    const Literal literal;
-    const int line;
+    uint32_t start;
+    uint32_t length;
+    int line;
+    TokenType type;
+
+    Token (const TokenType type, const uint32_t start, const uint32_t length, const int line) :
+        start(start), length(length), line(line), type(type) {}
 
-    Token (const TokenType type, std::string lexeme, Literal literal, const int line) :
-        type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line) {}
+    std::string_view lexeme(const std::string_view source) const {
+        return source.substr(start, length);
+    }
 
-    std::string toString() const;
+    std::string toString(std::string_view source) const;
 };
 
 #endif //CIPR_TOKEN_H
\ No newline at end of file
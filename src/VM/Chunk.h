@@ -0,0 +1,81 @@
+#ifndef CIPR_CHUNK_H
+#define CIPR_CHUNK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Value/Value.h"
+
+enum class OpCode : uint8_t {
+    CONSTANT,       // u16 constant index
+    PUSH_NULL,
+    PUSH_TRUE,
+    PUSH_FALSE,
+    POP,
+
+    DEFINE_GLOBAL,  // u16 global slot
+    GET_GLOBAL,     // u16 global slot
+    SET_GLOBAL,     // u16 global slot
+    STORE_GLOBAL,   // u16 global slot, pops the assigned value
+    GET_LOCAL,      // u8 frame slot
+    SET_LOCAL,      // u8 frame slot
+    STORE_LOCAL,    // u8 frame slot, pops the assigned value
+    GET_UPVALUE,    // u8 upvalue index
+    SET_UPVALUE,    // u8 upvalue index
+    STORE_UPVALUE,  // u8 upvalue index, pops the assigned value
+    CLOSE_UPVALUE,
+
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    NEGATE,
+    NOT,
+    EQUAL,
+    NOT_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    LESS,
+    LESS_EQUAL,
+
+    JUMP,           // u16 forward offset
+    JUMP_IF_FALSE,  // u16 forward offset, leaves the condition on the stack
+    POP_JUMP_IF_FALSE, // u16 forward offset, pops the condition
+    LOOP,           // u16 backward offset
+
+    CALL,           // u8 argument count
+    TAIL_CALL,      // u8 argument count, always followed by RETURN
+    CLOSURE,        // u16 function index, then (isLocal, index) byte pairs
+    RETURN,
+
+    ARRAY,          // u16 element count
+    MAP,            // u16 entry count, each a key then a value
+    INDEX_GET,
+    INDEX_SET,      // leaves the assigned value
+    ECHO,
+};
+
+struct VMFunction;
+
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::vector<int> lines;
+    std::vector<Value> constants;
+    std::vector<std::shared_ptr<VMFunction>> functions;
+
+    void write(const uint8_t byte, const int line) {
+        code.push_back(byte);
+        lines.push_back(line);
+    }
+};
+
+struct VMFunction {
+    std::string name;
+    int arity = 0;
+    int upvalueCount = 0;
+    int maxStack = 0;  // deepest operand stack use, including locals
+    Chunk chunk;
+};
+
+#endif //CIPR_CHUNK_H
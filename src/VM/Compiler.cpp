@@ -0,0 +1,572 @@
+#include "Compiler.h"
+#include "VM.h"
+
+std::shared_ptr<VMFunction> Compiler::compile(const int rootIndex) {
+    FunctionState script{nullptr, std::make_shared<VMFunction>(), {}, {}, 0, 0};
+    script.function->name = "script";
+    script.locals.push_back({"", 0, false, true});
+    current = &script;
+    adjustStack(1);
+
+    const Node root = arena.get(rootIndex);
+    for (const int child : root.children()) {
+        statement(child);
+    }
+    emit(OpCode::PUSH_NULL, root.line());
+    emit(OpCode::RETURN, root.line());
+
+    current = nullptr;
+    return script.function;
+}
+
+void Compiler::statement(const int index) {
+    if (index == -1)
+        return;
+
+    switch (const Node node = arena.get(index); node.type()) {
+        case NodeType::STMT_LIST:
+            for (const int child : node.children()) {
+                statement(child);
+            }
+            break;
+        case NodeType::STMT_VAR_DECL:
+            varDeclaration(node);
+            break;
+        case NodeType::STMT_ECHO:
+            expression(node.child(0));
+            emit(OpCode::ECHO, node.line());
+            break;
+        case NodeType::STMT_EXPR:
+            if (node.child(0) != -1 && arena.get(node.child(0)).type() == NodeType::ASSIGN) {
+                assignment(arena.get(node.child(0)), false);
+                break;
+            }
+            expression(node.child(0));
+            emit(OpCode::POP, node.line());
+            break;
+        case NodeType::STMT_BLOCK:
+            block(node);
+            break;
+        case NodeType::STMT_IF:
+            ifStatement(node);
+            break;
+        case NodeType::STMT_WHILE:
+            whileStatement(node);
+            break;
+        case NodeType::STMT_FUNCTION:
+            functionDeclaration(node);
+            break;
+        case NodeType::STMT_RETURN:
+            returnStatement(node);
+            break;
+        default:
+            expression(index);
+            emit(OpCode::POP, node.line());
+            break;
+    }
+}
+
+void Compiler::expression(const int index) {
+    if (index == -1) {
+        emit(OpCode::PUSH_NULL, 0);
+        return;
+    }
+
+    switch (const Node node = arena.get(index); node.type()) {
+        case NodeType::LITERAL:
+            if (node.value().isNull()) {
+                emit(OpCode::PUSH_NULL, node.line());
+            } else if (node.value().isBool()) {
+                emit(node.value().asBool() ? OpCode::PUSH_TRUE : OpCode::PUSH_FALSE, node.line());
+            } else {
+                emitConstant(node.value(), node.line());
+            }
+            break;
+        case NodeType::GROUPING:
+            expression(node.child(0));
+            break;
+        case NodeType::UNARY:
+            expression(node.child(0));
+            if (node.op() == MINUS) {
+                emit(OpCode::NEGATE, node.line());
+            } else if (node.op() == BANG) {
+                emit(OpCode::NOT, node.line());
+            }
+            break;
+        case NodeType::BINARY:
+        case NodeType::ADD_NUM:
+        case NodeType::SUBTRACT_NUM:
+        case NodeType::MULTIPLY_NUM:
+        case NodeType::DIVIDE_NUM:
+        case NodeType::LESS_NUM:
+        case NodeType::LESS_EQUAL_NUM:
+        case NodeType::GREATER_NUM:
+        case NodeType::GREATER_EQUAL_NUM:
+        case NodeType::ADD_STR:
+            binary(node);
+            break;
+        case NodeType::LOGICAL:
+            logical(node);
+            break;
+        case NodeType::VAR_EXPR:
+            variable(node);
+            break;
+        case NodeType::ASSIGN:
+            assignment(node, true);
+            break;
+        case NodeType::CALL:
+            call(node);
+            break;
+        case NodeType::ARRAY:
+            array(node);
+            break;
+        case NodeType::INDEX_GET:
+            expression(node.child(0));
+            expression(node.child(1));
+            emit(OpCode::INDEX_GET, node.line());
+            break;
+        case NodeType::INDEX_SET:
+            expression(node.child(0));
+            expression(node.child(1));
+            expression(node.child(2));
+            emit(OpCode::INDEX_SET, node.line());
+            break;
+        case NodeType::MAP:
+            map(node);
+            break;
+        default:
+            emit(OpCode::PUSH_NULL, node.line());
+            break;
+    }
+}
+
+void Compiler::varDeclaration(const Node& node) {
+    const int line = node.line();
+    expression(node.children().empty() ? -1 : node.child(0));
+
+    if (current->scopeDepth == 0) {
+        emitGlobal(OpCode::DEFINE_GLOBAL, node.lexeme(), line);
+        return;
+    }
+
+    // Re-declaring a name in the same scope overwrites it, as Environment::define does.
+    if (const int slot = localInScope(node.lexeme()); slot != -1) {
+        current->locals[slot].declared = true;
+        emit(OpCode::STORE_LOCAL, line);
+        emitByte(static_cast<uint8_t>(slot), line);
+        return;
+    }
+
+    declareLocal(node.lexeme(), line);
+}
+
+void Compiler::functionDeclaration(const Node& node) {
+    const int line = node.line();
+
+    if (current->scopeDepth == 0) {
+        function(node);
+        emitGlobal(OpCode::DEFINE_GLOBAL, node.lexeme(), line);
+        return;
+    }
+
+    // The slot is normally set aside by declareFunctions, so the body can
+    // refer to itself and to the functions declared beside it.
+    int slot = localInScope(node.lexeme());
+    if (slot == -1) {
+        declareLocal(node.lexeme(), line);
+        slot = static_cast<int>(current->locals.size()) - 1;
+        emit(OpCode::PUSH_NULL, line);
+    }
+    current->locals[slot].declared = true;
+    function(node);
+    emit(OpCode::STORE_LOCAL, line);
+    emitByte(static_cast<uint8_t>(slot), line);
+}
+
+void Compiler::function(const Node& node) {
+    const int line = node.line();
+
+    FunctionState state{current, std::make_shared<VMFunction>(), {}, {}, 1, 0};
+    state.function->name = node.lexeme();
+    state.function->arity = static_cast<int>(node.children().size()) - 1;
+    state.locals.push_back({"", 1, false, true});
+    current = &state;
+    adjustStack(1 + state.function->arity);
+
+    for (size_t i = 0; i + 1 < node.children().size(); i++) {
+        declareLocal(arena.get(node.child(i)).lexeme(), line);
+    }
+
+    // The body shares the parameters' scope, matching Function::call.
+    const Node body = arena.get(node.children().back());
+    declareFunctions(body.children());
+    for (const int child : body.children()) {
+        statement(child);
+    }
+    emit(OpCode::PUSH_NULL, body.line());
+    emit(OpCode::RETURN, body.line());
+
+    state.function->upvalueCount = static_cast<int>(state.upvalues.size());
+    current = state.enclosing;
+
+    Chunk& target = chunk();
+    if (target.functions.size() >= UINT16_MAX) {
+        throw CompileError(line, "Too many functions in one chunk.");
+    }
+    target.functions.push_back(state.function);
+
+    emit(OpCode::CLOSURE, line);
+    emitShort(static_cast<int>(target.functions.size()) - 1, line);
+    for (const Upvalue& upvalue : state.upvalues) {
+        emitByte(upvalue.isLocal ? 1 : 0, line);
+        emitByte(upvalue.index, line);
+    }
+}
+
+void Compiler::block(const Node& node) {
+    beginScope();
+    declareFunctions(node.children());
+    for (const int child : node.children()) {
+        statement(child);
+    }
+    endScope(node.line());
+}
+
+void Compiler::ifStatement(const Node& node) {
+    const int line = node.line();
+    expression(node.child(0));
+
+    const int thenJump = emitJump(OpCode::POP_JUMP_IF_FALSE, line);
+    statement(node.child(1));
+
+    if (node.child(2) == -1) {
+        patchJump(thenJump, line);
+        return;
+    }
+
+    const int elseJump = emitJump(OpCode::JUMP, line);
+    patchJump(thenJump, line);
+    statement(node.child(2));
+    patchJump(elseJump, line);
+}
+
+void Compiler::whileStatement(const Node& node) {
+    const int line = node.line();
+    const int loopStart = static_cast<int>(chunk().code.size());
+
+    expression(node.child(0));
+    const int exitJump = emitJump(OpCode::POP_JUMP_IF_FALSE, line);
+    statement(node.child(1));
+    emitLoop(loopStart, line);
+    patchJump(exitJump, line);
+}
+
+void Compiler::returnStatement(const Node& node) {
+    const int value = node.children().empty() ? -1 : node.child(0);
+    if (current->enclosing != nullptr && value != -1 &&
+        arena.get(value).type() == NodeType::CALL) {
+        call(arena.get(value), OpCode::TAIL_CALL);
+    } else {
+        expression(value);
+    }
+    emit(OpCode::RETURN, node.line());
+}
+
+void Compiler::binary(const Node& node) {
+    const int line = node.line();
+    expression(node.child(0));
+    expression(node.child(1));
+
+    switch (node.op()) {
+        case PLUS: emit(OpCode::ADD, line); break;
+        case MINUS: emit(OpCode::SUBTRACT, line); break;
+        case STAR: emit(OpCode::MULTIPLY, line); break;
+        case SLASH: emit(OpCode::DIVIDE, line); break;
+        case EQUAL_EQUAL: emit(OpCode::EQUAL, line); break;
+        case BANG_EQUAL: emit(OpCode::NOT_EQUAL, line); break;
+        case GREATER: emit(OpCode::GREATER, line); break;
+        case GREATER_EQUAL: emit(OpCode::GREATER_EQUAL, line); break;
+        case LESS: emit(OpCode::LESS, line); break;
+        case LESS_EQUAL: emit(OpCode::LESS_EQUAL, line); break;
+        default:
+            emit(OpCode::POP, line);
+            emit(OpCode::POP, line);
+            emit(OpCode::PUSH_NULL, line);
+            break;
+    }
+}
+
+void Compiler::logical(const Node& node) {
+    const int line = node.line();
+    expression(node.child(0));
+
+    if (node.op() == OR) {
+        const int elseJump = emitJump(OpCode::JUMP_IF_FALSE, line);
+        const int endJump = emitJump(OpCode::JUMP, line);
+        patchJump(elseJump, line);
+        emit(OpCode::POP, line);
+        expression(node.child(1));
+        patchJump(endJump, line);
+    } else {
+        const int endJump = emitJump(OpCode::JUMP_IF_FALSE, line);
+        emit(OpCode::POP, line);
+        expression(node.child(1));
+        patchJump(endJump, line);
+    }
+}
+
+void Compiler::variable(const Node& node) {
+    const int line = node.line();
+    const std::string& name = node.lexeme();
+
+    if (const int slot = resolveLocal(current, name); slot != -1) {
+        emit(OpCode::GET_LOCAL, line);
+        emitByte(static_cast<uint8_t>(slot), line);
+    } else if (const int upvalue = resolveUpvalue(current, name, line); upvalue != -1) {
+        emit(OpCode::GET_UPVALUE, line);
+        emitByte(static_cast<uint8_t>(upvalue), line);
+    } else {
+        emitGlobal(OpCode::GET_GLOBAL, name, line);
+    }
+}
+
+// An assignment used as a statement stores and pops in one instruction.
+void Compiler::assignment(const Node& node, const bool keepValue) {
+    const int line = node.line();
+    const std::string& name = node.lexeme();
+    expression(node.child(0));
+
+    if (const int slot = resolveLocal(current, name); slot != -1) {
+        emit(keepValue ? OpCode::SET_LOCAL : OpCode::STORE_LOCAL, line);
+        emitByte(static_cast<uint8_t>(slot), line);
+    } else if (const int upvalue = resolveUpvalue(current, name, line); upvalue != -1) {
+        emit(keepValue ? OpCode::SET_UPVALUE : OpCode::STORE_UPVALUE, line);
+        emitByte(static_cast<uint8_t>(upvalue), line);
+    } else {
+        emitGlobal(keepValue ? OpCode::SET_GLOBAL : OpCode::STORE_GLOBAL, name, line);
+    }
+}
+
+void Compiler::call(const Node& node, const OpCode op) {
+    const int line = node.line();
+    for (const int child : node.children()) {
+        expression(child);
+    }
+    emit(op, line);
+    emitByte(static_cast<uint8_t>(node.children().size() - 1), line);
+    adjustStack(1 - static_cast<int>(node.children().size()));
+}
+
+void Compiler::array(const Node& node) {
+    const int line = node.line();
+    if (node.children().size() > UINT16_MAX) {
+        throw CompileError(line, "Too many elements in array literal.");
+    }
+    for (const int child : node.children()) {
+        expression(child);
+    }
+    emit(OpCode::ARRAY, line);
+    emitShort(static_cast<int>(node.children().size()), line);
+    adjustStack(1 - static_cast<int>(node.children().size()));
+}
+
+void Compiler::map(const Node& node) {
+    const int line = node.line();
+    const size_t entries = node.children().size() / 2;
+    if (entries > UINT16_MAX) {
+        throw CompileError(line, "Too many entries in map literal.");
+    }
+    for (const int child : node.children()) {
+        expression(child);
+    }
+    emit(OpCode::MAP, line);
+    emitShort(static_cast<int>(entries), line);
+    adjustStack(1 - static_cast<int>(node.children().size()));
+}
+
+void Compiler::beginScope() {
+    current->scopeDepth++;
+}
+
+void Compiler::endScope(const int line) {
+    current->scopeDepth--;
+
+    auto& locals = current->locals;
+    while (!locals.empty() && locals.back().depth > current->scopeDepth) {
+        emit(locals.back().isCaptured ? OpCode::CLOSE_UPVALUE : OpCode::POP, line);
+        locals.pop_back();
+    }
+}
+
+void Compiler::declareLocal(const std::string& name, const int line) {
+    if (current->locals.size() > UINT8_MAX) {
+        throw CompileError(line, "Too many local variables in function.");
+    }
+    current->locals.push_back({name, current->scopeDepth, false, true});
+}
+
+// Functions in a scope may call each other, so each gets its slot before any
+// body is compiled, as Resolver::declareAll does. Straight-line code still
+// only sees a function from its declaration on.
+void Compiler::declareFunctions(const Children statements) {
+    for (const int child : statements) {
+        if (child == -1) continue;
+        const Node node = arena.get(child);
+        if (node.type() != NodeType::STMT_FUNCTION || localInScope(node.lexeme()) != -1) continue;
+        declareLocal(node.lexeme(), node.line());
+        current->locals.back().declared = false;
+        emit(OpCode::PUSH_NULL, node.line());
+    }
+}
+
+int Compiler::localInScope(const std::string& name) const {
+    for (int i = static_cast<int>(current->locals.size()) - 1; i >= 0; i--) {
+        const Local& local = current->locals[i];
+        if (local.depth < current->scopeDepth)
+            break;
+        if (local.name == name)
+            return i;
+    }
+    return -1;
+}
+
+int Compiler::resolveLocal(const FunctionState* state, const std::string& name, const bool nested) const {
+    for (int i = static_cast<int>(state->locals.size()) - 1; i > 0; i--) {
+        if (state->locals[i].name == name && (state->locals[i].declared || nested))
+            return i;
+    }
+    return -1;
+}
+
+int Compiler::resolveUpvalue(FunctionState* state, const std::string& name, const int line) {
+    if (state->enclosing == nullptr)
+        return -1;
+
+    if (const int local = resolveLocal(state->enclosing, name, true); local != -1) {
+        state->enclosing->locals[local].isCaptured = true;
+        return addUpvalue(state, static_cast<uint8_t>(local), true, line);
+    }
+
+    if (const int upvalue = resolveUpvalue(state->enclosing, name, line); upvalue != -1) {
+        return addUpvalue(state, static_cast<uint8_t>(upvalue), false, line);
+    }
+
+    return -1;
+}
+
+int Compiler::addUpvalue(FunctionState* state, const uint8_t index, const bool isLocal, const int line) {
+    for (size_t i = 0; i < state->upvalues.size(); i++) {
+        if (state->upvalues[i].index == index && state->upvalues[i].isLocal == isLocal)
+            return static_cast<int>(i);
+    }
+
+    if (state->upvalues.size() > UINT8_MAX) {
+        throw CompileError(line, "Too many closure variables in function.");
+    }
+    state->upvalues.push_back({index, isLocal});
+    return static_cast<int>(state->upvalues.size()) - 1;
+}
+
+void Compiler::emit(const OpCode op, const int line) {
+    chunk().write(static_cast<uint8_t>(op), line);
+
+    // CALL, TAIL_CALL, ARRAY and MAP depend on their operand and are adjusted by the caller.
+    switch (op) {
+        case OpCode::CONSTANT:
+        case OpCode::PUSH_NULL:
+        case OpCode::PUSH_TRUE:
+        case OpCode::PUSH_FALSE:
+        case OpCode::GET_GLOBAL:
+        case OpCode::GET_LOCAL:
+        case OpCode::GET_UPVALUE:
+        case OpCode::CLOSURE:
+            adjustStack(1);
+            break;
+        case OpCode::POP:
+        case OpCode::DEFINE_GLOBAL:
+        case OpCode::STORE_GLOBAL:
+        case OpCode::STORE_LOCAL:
+        case OpCode::STORE_UPVALUE:
+        case OpCode::POP_JUMP_IF_FALSE:
+        case OpCode::CLOSE_UPVALUE:
+        case OpCode::ADD:
+        case OpCode::SUBTRACT:
+        case OpCode::MULTIPLY:
+        case OpCode::DIVIDE:
+        case OpCode::EQUAL:
+        case OpCode::NOT_EQUAL:
+        case OpCode::GREATER:
+        case OpCode::GREATER_EQUAL:
+        case OpCode::LESS:
+        case OpCode::LESS_EQUAL:
+        case OpCode::RETURN:
+        case OpCode::INDEX_GET:
+        case OpCode::ECHO:
+            adjustStack(-1);
+            break;
+        case OpCode::INDEX_SET:
+            adjustStack(-2);
+            break;
+        default:
+            break;
+    }
+}
+
+void Compiler::adjustStack(const int delta) const {
+    current->stackDepth += delta;
+    if (current->stackDepth > current->function->maxStack)
+        current->function->maxStack = current->stackDepth;
+}
+
+void Compiler::emitByte(const uint8_t byte, const int line) {
+    chunk().write(byte, line);
+}
+
+void Compiler::emitShort(const int value, const int line) {
+    emitByte(static_cast<uint8_t>((value >> 8) & 0xff), line);
+    emitByte(static_cast<uint8_t>(value & 0xff), line);
+}
+
+void Compiler::emitConstant(const Value& value, const int line) {
+    auto& constants = chunk().constants;
+    if (constants.size() >= UINT16_MAX) {
+        throw CompileError(line, "Too many constants in one chunk.");
+    }
+    constants.push_back(value);
+    emit(OpCode::CONSTANT, line);
+    emitShort(static_cast<int>(constants.size()) - 1, line);
+}
+
+void Compiler::emitGlobal(const OpCode op, const std::string& name, const int line) {
+    const int slot = vm.globalSlot(name);
+    if (slot > UINT16_MAX) {
+        throw CompileError(line, "Too many global variables.");
+    }
+    emit(op, line);
+    emitShort(slot, line);
+}
+
+int Compiler::emitJump(const OpCode op, const int line) {
+    emit(op, line);
+    emitByte(0xff, line);
+    emitByte(0xff, line);
+    return static_cast<int>(chunk().code.size()) - 2;
+}
+
+void Compiler::patchJump(const int offset, const int line) {
+    const int jump = static_cast<int>(chunk().code.size()) - offset - 2;
+    if (jump > UINT16_MAX) {
+        throw CompileError(line, "Too much code to jump over.");
+    }
+    chunk().code[offset] = static_cast<uint8_t>((jump >> 8) & 0xff);
+    chunk().code[offset + 1] = static_cast<uint8_t>(jump & 0xff);
+}
+
+void Compiler::emitLoop(const int loopStart, const int line) {
+    emit(OpCode::LOOP, line);
+    const int offset = static_cast<int>(chunk().code.size()) - loopStart + 2;
+    if (offset > UINT16_MAX) {
+        throw CompileError(line, "Loop body too large.");
+    }
+    emitShort(offset, line);
+}
@@ -0,0 +1,98 @@
+#ifndef CIPR_COMPILER_H
+#define CIPR_COMPILER_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "AST/Node.h"
+#include "Chunk.h"
+
+class VM;
+
+// Lowers the Arena AST produced by Parser::parse into bytecode for the VM.
+class Compiler {
+public:
+    class CompileError final : public std::runtime_error {
+    public:
+        const int line;
+
+        CompileError(const int line, const std::string& message)
+            : std::runtime_error(message), line(line) {}
+    };
+
+    Compiler(Arena& arena, VM& vm) : arena(arena), vm(vm) {}
+
+    // Compiles a STMT_LIST root into the top-level script function.
+    std::shared_ptr<VMFunction> compile(int rootIndex);
+
+private:
+    struct Local {
+        std::string name;
+        int depth;
+        bool isCaptured;
+        // False for a function set aside by declareFunctions until its
+        // declaration is reached.
+        bool declared;
+    };
+
+    struct Upvalue {
+        uint8_t index;
+        bool isLocal;
+    };
+
+    struct FunctionState {
+        FunctionState* enclosing;
+        std::shared_ptr<VMFunction> function;
+        std::vector<Local> locals;
+        std::vector<Upvalue> upvalues;
+        int scopeDepth;
+        int stackDepth;
+    };
+
+    Arena& arena;
+    VM& vm;
+    FunctionState* current = nullptr;
+
+    void statement(int index);
+    void expression(int index);
+
+    void varDeclaration(const Node& node);
+    void functionDeclaration(const Node& node);
+    void function(const Node& node);
+    void block(const Node& node);
+    void ifStatement(const Node& node);
+    void whileStatement(const Node& node);
+    void returnStatement(const Node& node);
+
+    void binary(const Node& node);
+    void logical(const Node& node);
+    void variable(const Node& node);
+    void assignment(const Node& node, bool keepValue);
+    void call(const Node& node, OpCode op = OpCode::CALL);
+    void array(const Node& node);
+    void map(const Node& node);
+
+    void beginScope();
+    void endScope(int line);
+    void declareLocal(const std::string& name, int line);
+    void declareFunctions(Children statements);
+    int localInScope(const std::string& name) const;
+    // A `nested` function may also see functions not yet declared.
+    int resolveLocal(const FunctionState* state, const std::string& name, bool nested = false) const;
+    int resolveUpvalue(FunctionState* state, const std::string& name, int line);
+    int addUpvalue(FunctionState* state, uint8_t index, bool isLocal, int line);
+
+    Chunk& chunk() const { return current->function->chunk; }
+    void emit(OpCode op, int line);
+    void adjustStack(int delta) const;
+    void emitByte(uint8_t byte, int line);
+    void emitShort(int value, int line);
+    void emitConstant(const Value& value, int line);
+    void emitGlobal(OpCode op, const std::string& name, int line);
+    int emitJump(OpCode op, int line);
+    void patchJump(int offset, int line);
+    void emitLoop(int loopStart, int line);
+};
+
+#endif //CIPR_COMPILER_H
@@ -0,0 +1,596 @@
+#include "VM.h"
+
+#include <algorithm>
+#include "Interpreter/Interpreter.h"
+#include "Common/RuntimeError.h"
+#include "Value/Map.h"
+#include "Core/Core.h"
+
+int VMClosure::arity() {
+    return function->arity;
+}
+
+Value VMClosure::call(Interpreter&, const Arguments arguments) {
+    return vm.call(*this, arguments);
+}
+
+std::string VMClosure::toString() {
+    return "<fn " + function->name + ">";
+}
+
+VM::VM(Interpreter& interpreter) : interpreter(interpreter) {
+    stack.resize(1024);
+    frames.reserve(64);
+}
+
+int VM::globalSlot(const std::string& name) {
+    if (const auto it = globalSlots.find(name); it != globalSlots.end())
+        return it->second;
+
+    const int slot = static_cast<int>(globalNames.size());
+    globalSlots.emplace(name, slot);
+    globalNames.push_back(name);
+    globals.push_back(nullptr);
+    return slot;
+}
+
+Value* VM::resolveGlobal(const int slot) {
+    Value* value = globals[slot];
+    if (value == nullptr) {
+        value = interpreter.globals->lookup(globalNames[slot]);
+        globals[slot] = value;
+    }
+    return value;
+}
+
+void VM::interpret(const std::shared_ptr<VMFunction>& script) {
+    const size_t stackDepth = top;
+    const size_t frameDepth = frames.size();
+
+    try {
+        const Value closure = Value::make<VMClosure>(*this, script);
+        pushFrame(*static_cast<VMClosure*>(closure.asCallable()), top);
+        stack[top++] = closure;
+        run(frameDepth);
+    } catch (const RuntimeError& error) {
+        interpreter.getCore().runtimeError(error);
+        unwind(stackDepth, frameDepth);
+    } catch (...) {
+        // A ScriptExit, or whatever else the embedder catches, must leave
+        // the VM ready for the next script.
+        unwind(stackDepth, frameDepth);
+        throw;
+    }
+}
+
+Value VM::call(VMClosure& closure, const Arguments arguments) {
+    const size_t stackDepth = top;
+    const size_t frameDepth = frames.size();
+
+    // Slot zero normally holds the callee; the caller keeps this closure alive.
+    pushFrame(closure, top);
+    stack[top++] = Value();
+    for (size_t i = 0; i < arguments.size(); i++) {
+        stack[top++] = arguments[i];
+    }
+
+    try {
+        return run(frameDepth);
+    } catch (...) {
+        unwind(stackDepth, frameDepth);
+        throw;
+    }
+}
+
+void VM::pushFrame(VMClosure& closure, const size_t base) {
+    if (frames.size() >= FRAMES_MAX) {
+        runtimeError("Stack overflow.");
+    }
+
+    const size_t needed = base + closure.function->maxStack;
+    if (needed > stack.size()) {
+        stack.resize(std::max(needed, stack.size() * 2));
+    }
+    frames.push_back({&closure, closure.function->chunk.code.data(), base});
+}
+
+void VM::callValue(const int argCount) {
+    Collector::instance().maybeCollect();
+    const size_t base = top - argCount - 1;
+    if (!stack[base].isCallable()) {
+        runtimeError("Can only call functions and classes.");
+    }
+
+    Callable* function = stack[base].asCallable();
+    if (auto* closure = dynamic_cast<VMClosure*>(function)) {
+        if (argCount != closure->function->arity) {
+            runtimeError("Expected " + std::to_string(closure->function->arity) +
+                " arguments but got " + std::to_string(argCount) + ".");
+        }
+        pushFrame(*closure, base);
+        return;
+    }
+
+    if (argCount != function->arity()) {
+        runtimeError("Expected " + std::to_string(function->arity()) +
+            " arguments but got " + std::to_string(argCount) + ".");
+    }
+
+    // The arguments stay on the stack below `top`, so a native that re-enters
+    // the VM pushes its frames above them.
+    Value result = function->call(interpreter, Arguments(stack, base + 1, argCount));
+    for (size_t i = base + 1; i < top; i++) {
+        release(stack[i]);
+    }
+    top = base + 1;
+    stack[base] = std::move(result);
+}
+
+void VM::unwind(const size_t stackDepth, const size_t frameDepth) {
+    closeUpvalues(stackDepth);
+    for (size_t i = stackDepth; i < top; i++) {
+        release(stack[i]);
+    }
+    top = stackDepth;
+    frames.resize(frameDepth);
+}
+
+std::shared_ptr<VMUpvalue> VM::captureUpvalue(const size_t slot) {
+    auto it = openUpvalues.end();
+    while (it != openUpvalues.begin() && (*(it - 1))->slot >= slot) {
+        --it;
+        if ((*it)->slot == slot)
+            return *it;
+    }
+
+    auto upvalue = std::make_shared<VMUpvalue>(slot);
+    openUpvalues.insert(it, upvalue);
+    return upvalue;
+}
+
+void VM::closeUpvalues(const size_t fromSlot) {
+    while (!openUpvalues.empty() && openUpvalues.back()->slot >= fromSlot) {
+        VMUpvalue& upvalue = *openUpvalues.back();
+        upvalue.closed = stack[upvalue.slot];
+        upvalue.isOpen = false;
+        openUpvalues.pop_back();
+    }
+}
+
+Value* VM::makeArray(Value* first, const uint16_t count) {
+    Value list = Value::make<LiteralVector>();
+    auto& elements = list.asArray()->elements;
+    elements.reserve(count);
+    for (Value* slot = first; slot < first + count; ++slot) {
+        elements.push_back(std::move(*slot));
+    }
+    *first = std::move(list);
+    for (Value* slot = first + 1; slot < first + count; ++slot) {
+        release(*slot);
+    }
+    return first + 1;
+}
+
+Value* VM::makeMap(Value* first, const uint16_t count) {
+    Value map = Value::make<LiteralMap>();
+    LiteralMap* entries = map.asMap();
+    entries->reserve(count);
+    for (Value* slot = first; slot < first + 2 * count; slot += 2) {
+        entries->set(slot[0], std::move(slot[1]));
+    }
+    for (Value* slot = first + 1; slot < first + 2 * count; ++slot) {
+        release(*slot);
+    }
+    *first = std::move(map);
+    return first + 1;
+}
+
+void VM::release(Value& value) {
+    if (value.isObject()) {
+        value = Value();
+    }
+}
+
+void VM::runtimeError(const std::string& message) const {
+    int line = 0;
+    if (!frames.empty()) {
+        const CallFrame& frame = frames.back();
+        const Chunk& chunk = frame.closure->function->chunk;
+        const size_t offset = frame.ip - chunk.code.data();
+        if (offset > 0 && offset <= chunk.lines.size())
+            line = chunk.lines[offset - 1];
+    }
+    throw RuntimeError(line, message);
+}
+
+Value VM::run(const size_t exitDepth) {
+    CallFrame* frame = &frames.back();
+    const uint8_t* ip = frame->ip;
+    Value* slots = stack.data() + frame->base;
+    Value* sp = stack.data() + top;
+    const Value* constants = frame->closure->function->chunk.constants.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define SYNC() (frame->ip = ip, top = static_cast<size_t>(sp - stack.data()))
+#define RELOAD() (frame = &frames.back(), ip = frame->ip, slots = stack.data() + frame->base, \
+    sp = stack.data() + top, constants = frame->closure->function->chunk.constants.data())
+#define RUNTIME_ERROR(message) (SYNC(), runtimeError(message))
+#define NUMBER_OPERANDS()                                                      \
+    if (!sp[-2].isNumber() || !sp[-1].isNumber())                              \
+        RUNTIME_ERROR("Operands must be numbers.");                            \
+    const double a = sp[-2].asNumber();                                        \
+    const double b = sp[-1].asNumber()
+
+#if defined(__GNUC__)
+    // Threaded dispatch: each handler jumps straight to the next one.
+    static void* const dispatchTable[] = {
+        &&op_CONSTANT, &&op_PUSH_NULL, &&op_PUSH_TRUE, &&op_PUSH_FALSE, &&op_POP,
+        &&op_DEFINE_GLOBAL, &&op_GET_GLOBAL, &&op_SET_GLOBAL, &&op_STORE_GLOBAL, &&op_GET_LOCAL,
+        &&op_SET_LOCAL, &&op_STORE_LOCAL, &&op_GET_UPVALUE, &&op_SET_UPVALUE, &&op_STORE_UPVALUE,
+        &&op_CLOSE_UPVALUE, &&op_ADD, &&op_SUBTRACT, &&op_MULTIPLY, &&op_DIVIDE, &&op_NEGATE,
+        &&op_NOT, &&op_EQUAL, &&op_NOT_EQUAL, &&op_GREATER, &&op_GREATER_EQUAL, &&op_LESS,
+        &&op_LESS_EQUAL, &&op_JUMP, &&op_JUMP_IF_FALSE, &&op_POP_JUMP_IF_FALSE, &&op_LOOP,
+        &&op_CALL, &&op_TAIL_CALL, &&op_CLOSURE, &&op_RETURN, &&op_ARRAY, &&op_MAP, &&op_INDEX_GET,
+        &&op_INDEX_SET, &&op_ECHO
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) ==
+        static_cast<size_t>(OpCode::ECHO) + 1, "dispatch table out of sync with OpCode");
+// A computed goto does not run destructors, so no handler may hold an owning
+// local across DISPATCH().
+#define TARGET(op) op_##op: case OpCode::op
+#define DISPATCH() goto *dispatchTable[READ_BYTE()]
+#else
+#define TARGET(op) case OpCode::op
+#define DISPATCH() break
+#endif
+
+    while (true) {
+        switch (static_cast<OpCode>(READ_BYTE())) {
+            TARGET(CONSTANT):
+                *sp++ = constants[READ_SHORT()];
+                DISPATCH();
+            TARGET(PUSH_NULL):
+                *sp++ = Value();
+                DISPATCH();
+            TARGET(PUSH_TRUE):
+                *sp++ = true;
+                DISPATCH();
+            TARGET(PUSH_FALSE):
+                *sp++ = false;
+                DISPATCH();
+            TARGET(POP):
+                release(*--sp);
+                DISPATCH();
+
+            TARGET(DEFINE_GLOBAL): {
+                const int slot = READ_SHORT();
+                interpreter.globals->define(globalNames[slot], sp[-1]);
+                release(*--sp);
+                globals[slot] = interpreter.globals->lookup(globalNames[slot]);
+                DISPATCH();
+            }
+            TARGET(GET_GLOBAL): {
+                const int slot = READ_SHORT();
+                const Value* value = resolveGlobal(slot);
+                if (value == nullptr) {
+                    RUNTIME_ERROR("Undefined variable '" + globalNames[slot] + "'.");
+                }
+                *sp++ = *value;
+                DISPATCH();
+            }
+            TARGET(SET_GLOBAL): {
+                const int slot = READ_SHORT();
+                Value* value = resolveGlobal(slot);
+                if (value == nullptr) {
+                    RUNTIME_ERROR("Undefined variable '" + globalNames[slot] + "'.");
+                }
+                *value = sp[-1];
+                DISPATCH();
+            }
+            TARGET(STORE_GLOBAL): {
+                const int slot = READ_SHORT();
+                Value* value = resolveGlobal(slot);
+                if (value == nullptr) {
+                    RUNTIME_ERROR("Undefined variable '" + globalNames[slot] + "'.");
+                }
+                *value = sp[-1];
+                release(*--sp);
+                DISPATCH();
+            }
+            TARGET(GET_LOCAL):
+                *sp++ = slots[READ_BYTE()];
+                DISPATCH();
+            TARGET(SET_LOCAL):
+                slots[READ_BYTE()] = sp[-1];
+                DISPATCH();
+            TARGET(STORE_LOCAL):
+                slots[READ_BYTE()] = sp[-1];
+                release(*--sp);
+                DISPATCH();
+            TARGET(GET_UPVALUE): {
+                const VMUpvalue& upvalue = *frame->closure->upvalues[READ_BYTE()];
+                *sp++ = upvalue.isOpen ? stack[upvalue.slot] : upvalue.closed;
+                DISPATCH();
+            }
+            TARGET(SET_UPVALUE): {
+                VMUpvalue& upvalue = *frame->closure->upvalues[READ_BYTE()];
+                (upvalue.isOpen ? stack[upvalue.slot] : upvalue.closed) = sp[-1];
+                DISPATCH();
+            }
+            TARGET(STORE_UPVALUE): {
+                VMUpvalue& upvalue = *frame->closure->upvalues[READ_BYTE()];
+                (upvalue.isOpen ? stack[upvalue.slot] : upvalue.closed) = sp[-1];
+                release(*--sp);
+                DISPATCH();
+            }
+            TARGET(CLOSE_UPVALUE):
+                closeUpvalues(static_cast<size_t>(sp - stack.data()) - 1);
+                release(*--sp);
+                DISPATCH();
+
+            TARGET(ADD): {
+                if (sp[-2].isNumber() && sp[-1].isNumber()) {
+                    sp[-2] = sp[-2].asNumber() + sp[-1].asNumber();
+                } else if (sp[-2].isString() || sp[-1].isString()) {
+                    sp[-2] = Interpreter::concatenate(sp[-2], sp[-1]);
+                } else {
+                    RUNTIME_ERROR("Operands must be two numbers or two strings.");
+                }
+                release(*--sp);
+                DISPATCH();
+            }
+            TARGET(SUBTRACT): {
+                NUMBER_OPERANDS();
+                sp[-2] = a - b;
+                --sp;
+                DISPATCH();
+            }
+            TARGET(MULTIPLY): {
+                NUMBER_OPERANDS();
+                sp[-2] = a * b;
+                --sp;
+                DISPATCH();
+            }
+            TARGET(DIVIDE): {
+                NUMBER_OPERANDS();
+                if (b == 0.0) {
+                    RUNTIME_ERROR("Division by zero.");
+                }
+                sp[-2] = a / b;
+                --sp;
+                DISPATCH();
+            }
+            TARGET(NEGATE): {
+                if (!sp[-1].isNumber()) {
+                    RUNTIME_ERROR("Operand must be a number.");
+                }
+                sp[-1] = -sp[-1].asNumber();
+                DISPATCH();
+            }
+            TARGET(NOT):
+                sp[-1] = !Interpreter::isTruthy(sp[-1]);
+                DISPATCH();
+            TARGET(EQUAL): {
+                const bool equal = sp[-2] == sp[-1];
+                release(*--sp);
+                sp[-1] = equal;
+                DISPATCH();
+            }
+            TARGET(NOT_EQUAL): {
+                const bool equal = sp[-2] == sp[-1];
+                release(*--sp);
+                sp[-1] = !equal;
+                DISPATCH();
+            }
+            TARGET(GREATER): {
+                NUMBER_OPERANDS();
+                sp[-2] = a > b;
+                --sp;
+                DISPATCH();
+            }
+            TARGET(GREATER_EQUAL): {
+                NUMBER_OPERANDS();
+                sp[-2] = a >= b;
+                --sp;
+                DISPATCH();
+            }
+            TARGET(LESS): {
+                NUMBER_OPERANDS();
+                sp[-2] = a < b;
+                --sp;
+                DISPATCH();
+            }
+            TARGET(LESS_EQUAL): {
+                NUMBER_OPERANDS();
+                sp[-2] = a <= b;
+                --sp;
+                DISPATCH();
+            }
+
+            TARGET(JUMP): {
+                const uint16_t offset = READ_SHORT();
+                ip += offset;
+                DISPATCH();
+            }
+            TARGET(JUMP_IF_FALSE): {
+                const uint16_t offset = READ_SHORT();
+                if (!Interpreter::isTruthy(sp[-1]))
+                    ip += offset;
+                DISPATCH();
+            }
+            TARGET(POP_JUMP_IF_FALSE): {
+                const uint16_t offset = READ_SHORT();
+                if (!Interpreter::isTruthy(sp[-1]))
+                    ip += offset;
+                release(*--sp);
+                DISPATCH();
+            }
+            TARGET(LOOP): {
+                const uint16_t offset = READ_SHORT();
+                ip -= offset;
+                Collector::instance().maybeCollect();
+                DISPATCH();
+            }
+
+            TARGET(CALL): {
+                const int argCount = READ_BYTE();
+                SYNC();
+                callValue(argCount);
+                RELOAD();
+                DISPATCH();
+            }
+            TARGET(TAIL_CALL): {
+                const int argCount = READ_BYTE();
+                Value* callee = sp - argCount - 1;
+                auto* closure = callee->isCallable()
+                    ? dynamic_cast<VMClosure*>(callee->asCallable()) : nullptr;
+                if (closure == nullptr || argCount != closure->function->arity) {
+                    // Natives and arity errors take the ordinary path; the
+                    // RETURN that follows hands back the result.
+                    SYNC();
+                    callValue(argCount);
+                    RELOAD();
+                    DISPATCH();
+                }
+
+                // Reuse the current frame: the callee and its arguments move
+                // down over this call's slots, which are released.
+                closeUpvalues(frame->base);
+                for (int i = 0; i <= argCount; i++) {
+                    std::swap(slots[i], callee[i]);
+                }
+                for (Value* slot = slots + argCount + 1; slot < sp; ++slot) {
+                    release(*slot);
+                }
+                sp = slots + argCount + 1;
+
+                frame->closure = closure;
+                frame->ip = closure->function->chunk.code.data();
+                top = static_cast<size_t>(sp - stack.data());
+                if (const size_t needed = frame->base + closure->function->maxStack; needed > stack.size()) {
+                    stack.resize(std::max(needed, stack.size() * 2));
+                }
+                RELOAD();
+                DISPATCH();
+            }
+            TARGET(CLOSURE): {
+                const auto& function = frame->closure->function->chunk.functions[READ_SHORT()];
+                *sp = Value::make<VMClosure>(*this, function);
+                auto* closure = static_cast<VMClosure*>(sp++->asCallable());
+                closure->upvalues.reserve(function->upvalueCount);
+                for (int i = 0; i < function->upvalueCount; i++) {
+                    const uint8_t isLocal = READ_BYTE();
+                    const uint8_t index = READ_BYTE();
+                    if (isLocal) {
+                        closure->upvalues.push_back(captureUpvalue(frame->base + index));
+                    } else {
+                        closure->upvalues.push_back(frame->closure->upvalues[index]);
+                    }
+                }
+                DISPATCH();
+            }
+            TARGET(RETURN): {
+                closeUpvalues(frame->base);
+                // The result moves down into the callee's first slot.
+                std::swap(*slots, sp[-1]);
+                for (Value* slot = slots + 1; slot < sp; ++slot) {
+                    release(*slot);
+                }
+                sp = slots + 1;
+                frames.pop_back();
+
+                if (frames.size() == exitDepth) {
+                    top = static_cast<size_t>(slots - stack.data());
+                    return std::move(*slots);
+                }
+
+                frame = &frames.back();
+                ip = frame->ip;
+                slots = stack.data() + frame->base;
+                constants = frame->closure->function->chunk.constants.data();
+                DISPATCH();
+            }
+
+            TARGET(ARRAY): {
+                const uint16_t count = READ_SHORT();
+                sp = makeArray(sp - count, count);
+                DISPATCH();
+            }
+            TARGET(MAP): {
+                const uint16_t count = READ_SHORT();
+                sp = makeMap(sp - 2 * count, count);
+                DISPATCH();
+            }
+            TARGET(INDEX_GET): {
+                if (sp[-2].isMap()) {
+                    // A missing key reads as null.
+                    const Value* value = sp[-2].asMap()->find(sp[-1]);
+                    *--sp = value ? *value : Value();
+                    std::swap(sp[-1], *sp);
+                    release(*sp);
+                    DISPATCH();
+                }
+                if (!sp[-2].isArray()) {
+                    RUNTIME_ERROR("Only arrays and maps can be indexed.");
+                }
+                if (!sp[-1].isNumber()) {
+                    RUNTIME_ERROR("Index must be a number.");
+                }
+
+                const LiteralVector* list = sp[-2].asArray();
+                const int i = static_cast<int>(sp[-1].asNumber());
+                if (i < 0 || i >= static_cast<int>(list->elements.size())) {
+                    RUNTIME_ERROR("Array index out of bounds.");
+                }
+
+                *--sp = list->elements[i];
+                std::swap(sp[-1], *sp);
+                release(*sp);
+                DISPATCH();
+            }
+            TARGET(INDEX_SET): {
+                if (sp[-3].isMap()) {
+                    sp[-3].asMap()->set(sp[-2], sp[-1]);
+                } else {
+                    if (!sp[-3].isArray()) {
+                        RUNTIME_ERROR("Only arrays and maps can be indexed.");
+                    }
+                    if (!sp[-2].isNumber()) {
+                        RUNTIME_ERROR("Index must be a number.");
+                    }
+
+                    LiteralVector* list = sp[-3].asArray();
+                    const int i = static_cast<int>(sp[-2].asNumber());
+                    if (i < 0 || i >= static_cast<int>(list->elements.size())) {
+                        RUNTIME_ERROR("Array index out of bounds.");
+                    }
+                    list->elements[i] = sp[-1];
+                }
+
+                // The assigned value is the result.
+                std::swap(sp[-3], sp[-1]);
+                release(*--sp);
+                release(*--sp);
+                DISPATCH();
+            }
+            TARGET(ECHO):
+                if (sp[-1].isString()) {
+                    interpreter.getCore().print(sp[-1].asString());
+                } else {
+                    interpreter.getCore().print(Interpreter::stringify(sp[-1]));
+                }
+                release(*--sp);
+                DISPATCH();
+        }
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef SYNC
+#undef RELOAD
+#undef RUNTIME_ERROR
+#undef NUMBER_OPERANDS
+#undef TARGET
+#undef DISPATCH
+}
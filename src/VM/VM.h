@@ -0,0 +1,102 @@
+#ifndef CIPR_VM_H
+#define CIPR_VM_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Chunk.h"
+#include "Interpreter/Callable.h"
+
+class Interpreter;
+class VM;
+
+struct VMUpvalue final : Traceable, std::enable_shared_from_this<VMUpvalue> {
+    size_t slot;
+    Value closed;
+    bool isOpen = true;
+
+    explicit VMUpvalue(const size_t slot) : slot(slot) {}
+
+    size_t references() const override { return static_cast<size_t>(weak_from_this().use_count()); }
+    void trace(Tracer& tracer) override { tracer.visit(closed); }
+    void clear() override { closed = Value(); }
+    std::shared_ptr<void> hold() override { return shared_from_this(); }
+    size_t byteSize() const override { return sizeof(VMUpvalue); }
+};
+
+class VMClosure final : public Callable, public Traceable {
+public:
+    VMClosure(VM& vm, std::shared_ptr<VMFunction> function)
+        : vm(vm), function(std::move(function)) {}
+
+    int arity() override;
+    Value call(Interpreter& interpreter, Arguments arguments) override;
+    std::string toString() override;
+
+    Traceable* traceable() override { return this; }
+    size_t references() const override { return refCount; }
+    void trace(Tracer& tracer) override {
+        for (const auto& upvalue : upvalues) tracer.visit(upvalue.get());
+    }
+    void clear() override { upvalues.clear(); }
+    std::shared_ptr<void> hold() override { return std::make_shared<Value>(Value(this)); }
+    size_t byteSize() const override {
+        return sizeof(VMClosure) + upvalues.capacity() * sizeof(upvalues[0]);
+    }
+
+    VM& vm;
+    std::shared_ptr<VMFunction> function;
+    std::vector<std::shared_ptr<VMUpvalue>> upvalues;
+};
+
+// Stack machine for the bytecode produced by Compiler. Globals and natives are
+// shared with the tree-walking Interpreter through its global Environment.
+class VM {
+public:
+    explicit VM(Interpreter& interpreter);
+
+    void interpret(const std::shared_ptr<VMFunction>& script);
+    Value call(VMClosure& closure, Arguments arguments);
+
+    int globalSlot(const std::string& name);
+
+private:
+    struct CallFrame {
+        VMClosure* closure;
+        const uint8_t* ip;
+        size_t base;
+    };
+
+    static constexpr size_t FRAMES_MAX = 65536;
+
+    Interpreter& interpreter;
+
+    // Every slot stays constructed; [0, top) is live. Slots are addressed by
+    // index outside run() because re-entrant calls may grow the vector.
+    std::vector<Value> stack;
+    size_t top = 0;
+    std::vector<CallFrame> frames;
+    std::vector<std::shared_ptr<VMUpvalue>> openUpvalues;
+
+    std::unordered_map<std::string, int> globalSlots;
+    std::vector<std::string> globalNames;
+    std::vector<Value*> globals;
+
+    Value run(size_t exitDepth);
+    void callValue(int argCount);
+    void pushFrame(VMClosure& closure, size_t base);
+    Value* resolveGlobal(int slot);
+    void unwind(size_t stackDepth, size_t frameDepth);
+
+    std::shared_ptr<VMUpvalue> captureUpvalue(size_t slot);
+    void closeUpvalues(size_t fromSlot);
+
+    static Value* makeArray(Value* first, uint16_t count);
+    static Value* makeMap(Value* first, uint16_t count);
+    static void release(Value& value);
+
+    [[noreturn]] void runtimeError(const std::string& message) const;
+};
+
+#endif //CIPR_VM_H
@@ -0,0 +1,137 @@
+#include "Map.h"
+
+#include <algorithm>
+#include <cstring>
+
+uint32_t LiteralMap::hashOf(const Value& key) {
+    if (key.isString()) {
+        return static_cast<uint32_t>(static_cast<const String*>(key.asObject())->hash());
+    }
+
+    uint64_t bits;
+    if (key.isNumber()) {
+        // 0 and -0 are equal keys, so they must hash alike.
+        const double number = key.asNumber() == 0 ? 0.0 : key.asNumber();
+        std::memcpy(&bits, &number, sizeof(bits));
+    } else if (key.isObject()) {
+        bits = reinterpret_cast<uintptr_t>(key.asObject());
+    } else {
+        bits = key.isNull() ? 1 : key.asBool() ? 3 : 2;
+    }
+    // Whole numbers differ only in their top bits, so mix them all down.
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+    return static_cast<uint32_t>(bits);
+}
+
+size_t LiteralMap::slotOf(const Value& key, const uint32_t hash) const {
+    const size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.entry == EMPTY || (slot.hash == hash && items[slot.entry].key == key)) {
+            return i;
+        }
+    }
+}
+
+const Value* LiteralMap::find(const Value& key) const {
+    if (count == 0)
+        return nullptr;
+    const Slot& slot = slots[slotOf(key, hashOf(key))];
+    return slot.entry == EMPTY ? nullptr : &items[slot.entry].value;
+}
+
+void LiteralMap::set(const Value& key, Value value) {
+    if ((items.size() + 1) * 4 > slots.size() * 3) {
+        rebuild(count + 1);
+    }
+
+    const uint32_t hash = hashOf(key);
+    Slot& slot = slots[slotOf(key, hash)];
+    if (slot.entry != EMPTY) {
+        items[slot.entry].value = std::move(value);
+        return;
+    }
+    slot = {hash, static_cast<uint32_t>(items.size())};
+    items.push_back({key, std::move(value), hash, true});
+    count++;
+}
+
+bool LiteralMap::remove(const Value& key) {
+    if (count == 0)
+        return false;
+    const size_t mask = slots.size() - 1;
+    size_t gap = slotOf(key, hashOf(key));
+    if (slots[gap].entry == EMPTY)
+        return false;
+
+    // Released last: either may own the map's only other reference to `key`.
+    Entry& entry = items[slots[gap].entry];
+    entry.live = false;
+    const Value oldKey = std::move(entry.key);
+    const Value oldValue = std::move(entry.value);
+    count--;
+
+    // Later slots of the same probe run move back into the gap, so no probe
+    // stops short at it. A slot may move if the gap lies between its home
+    // slot and where it sits now.
+    for (size_t i = (gap + 1) & mask; slots[i].entry != EMPTY; i = (i + 1) & mask) {
+        const size_t home = slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - gap) & mask)) {
+            slots[gap] = slots[i];
+            gap = i;
+        }
+    }
+    slots[gap].entry = EMPTY;
+
+    if (items.size() > 2 * count + 8) {
+        rebuild(count);
+    }
+    return true;
+}
+
+void LiteralMap::reserve(const size_t entries) {
+    if (entries * 4 > slots.size() * 3) {
+        rebuild(entries);
+    }
+    items.reserve(entries);
+}
+
+void LiteralMap::rebuild(const size_t entries) {
+    if (count != items.size()) {
+        items.erase(std::remove_if(items.begin(), items.end(), [](const Entry& entry) { return !entry.live; }),
+                    items.end());
+    }
+
+    size_t capacity = 8;
+    while (capacity < entries * 2) capacity *= 2;
+    slots.assign(capacity, {0, EMPTY});
+
+    const size_t mask = capacity - 1;
+    for (size_t entry = 0; entry < items.size(); entry++) {
+        size_t i = items[entry].hash & mask;
+        while (slots[i].entry != EMPTY) i = (i + 1) & mask;
+        slots[i] = {items[entry].hash, static_cast<uint32_t>(entry)};
+    }
+}
+
+void LiteralMap::trace(Tracer& tracer) {
+    for (const Entry& entry : items) {
+        if (!entry.live) continue;
+        tracer.visit(entry.key);
+        tracer.visit(entry.value);
+    }
+}
+
+void LiteralMap::clear() {
+    items.clear();
+    slots.clear();
+    count = 0;
+}
+
+size_t LiteralMap::byteSize() const {
+    return sizeof(LiteralMap) + items.capacity() * sizeof(Entry) + slots.capacity() * sizeof(Slot);
+}
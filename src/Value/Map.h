@@ -0,0 +1,67 @@
+#ifndef CIPR_MAP_H
+#define CIPR_MAP_H
+
+#include <cstdint>
+#include <vector>
+#include "Value/Value.h"
+
+// Hash map from any Value to any Value. Keys match as they do under ==:
+// numbers by value, strings by content, other objects by identity.
+//
+// Entries sit in insertion order, which keys(), values() and echo follow.
+// The open-addressing index over them holds only each key's hash and entry
+// number, eight bytes a slot, so a probe reads one cache line and compares
+// keys only on a full hash match.
+struct LiteralMap final : Object, Traceable {
+    struct Entry {
+        Value key;
+        Value value;
+        uint32_t hash;
+        // Cleared by remove(); dead entries are dropped when the index is rebuilt.
+        bool live;
+    };
+
+    LiteralMap() : Object(ObjectType::MAP) {}
+
+    size_t size() const { return count; }
+    // Null if `key` is absent.
+    const Value* find(const Value& key) const;
+    void set(const Value& key, Value value);
+    // Returns false if `key` was absent.
+    bool remove(const Value& key);
+    void reserve(size_t entries);
+
+    // In insertion order, including dead ones.
+    const std::vector<Entry>& entries() const { return items; }
+
+    Traceable* traceable() override { return this; }
+    size_t references() const override { return refCount; }
+    void trace(Tracer& tracer) override;
+    void clear() override;
+    std::shared_ptr<void> hold() override { return std::make_shared<Value>(Value(this)); }
+    size_t byteSize() const override;
+
+private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t entry;
+    };
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<Entry> items;
+    // A power of two in size, at most three quarters full.
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    static uint32_t hashOf(const Value& key);
+    // The slot holding `key`, or the empty slot that ends its probe.
+    size_t slotOf(const Value& key, uint32_t hash) const;
+    // Drops dead entries and re-indexes the rest for `entries` live ones.
+    void rebuild(size_t entries);
+};
+
+inline LiteralMap* Value::asMap() const {
+    return static_cast<LiteralMap*>(asObject());
+}
+
+#endif //CIPR_MAP_H
@@ -0,0 +1,34 @@
+#include "Value.h"
+
+#include <unordered_map>
+
+namespace {
+    // Keys view the chars of the String they map to. Never destroyed, so
+    // Strings released during static destruction can still unregister.
+    std::unordered_map<std::string_view, String*>& internTable() {
+        static auto* table = new std::unordered_map<std::string_view, String*>();
+        return *table;
+    }
+}
+
+String* String::make(std::string chars) {
+    return new String(std::move(chars));
+}
+
+String* String::intern(const std::string_view chars) {
+    auto& table = internTable();
+    if (const auto it = table.find(chars); it != table.end()) {
+        return it->second;
+    }
+
+    auto* string = new String(std::string(chars));
+    string->interned = true;
+    table.emplace(string->chars, string);
+    return string;
+}
+
+String::~String() {
+    if (interned) {
+        internTable().erase(chars);
+    }
+}
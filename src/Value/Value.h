@@ -0,0 +1,203 @@
+#ifndef CIPR_VALUE_H
+#define CIPR_VALUE_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Collector/Collector.h"
+
+enum class ObjectType : uint8_t {
+    STRING,
+    ARRAY,
+    CALLABLE,
+    MAP,
+};
+
+// Header shared by every heap-allocated value. Each Value pointing at an
+// object holds one reference; the last one to go deletes it.
+struct Object {
+    const ObjectType type;
+    uint32_t refCount = 0;
+
+    explicit Object(const ObjectType type) : type(type) {}
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+    virtual ~Object() = default;
+
+    // Objects that can hold references to others return themselves here.
+    virtual Traceable* traceable() { return nullptr; }
+};
+
+// Immutable once created, so copies of a Value share one String. Identifier
+// names and short string literals are interned when compiled: two interned
+// Strings are equal only if they are the same object. Strings built at run
+// time are not, as the table lookup would cost more than it saves.
+struct String final : Object {
+    static constexpr size_t MAX_INTERNED_LENGTH = 64;
+
+    const std::string chars;
+    bool interned = false;
+
+    // Returns a new, uninterned String.
+    static String* make(std::string chars);
+    // Returns the interned String for `chars` whatever its length.
+    static String* intern(std::string_view chars);
+
+    // Computed the first time the String is used as a map key, then kept.
+    size_t hash() const {
+        if (hashCode == 0) {
+            hashCode = std::hash<std::string_view>{}(chars) | 1;
+        }
+        return hashCode;
+    }
+
+    ~String() override;
+
+private:
+    mutable size_t hashCode = 0;
+
+    explicit String(std::string chars) : Object(ObjectType::STRING), chars(std::move(chars)) {}
+};
+
+struct LiteralVector;
+struct LiteralMap;
+struct Callable;
+
+// A script value in 8 bytes. Numbers are stored as plain doubles; null,
+// booleans and object pointers live in the payload of a quiet NaN.
+class Value {
+public:
+    Value() : bits(NIL) {}
+    Value(const double number) { std::memcpy(&bits, &number, sizeof(number)); }
+    Value(std::string string) : Value(String::make(std::move(string))) {}
+    Value(const char* string) : Value(std::string(string)) {}
+
+    // Only a real bool converts, never a pointer or an integer.
+    template <typename T, std::enable_if_t<std::is_same_v<T, bool>, int> = 0>
+    Value(const T boolean) : bits(boolean ? TRUE_BITS : FALSE_BITS) {}
+
+    // Takes a reference to `object`; prefer Value::make for new objects.
+    template <typename T, std::enable_if_t<std::is_base_of_v<Object, T>, int> = 0>
+    explicit Value(T* object) : bits(SIGN_BIT | QNAN | reinterpret_cast<uintptr_t>(object)) {
+        retain();
+    }
+
+    template <typename T, typename... Args>
+    static Value make(Args&&... args) {
+        return Value(new T(std::forward<Args>(args)...));
+    }
+
+    Value(const Value& other) : bits(other.bits) { retain(); }
+    Value(Value&& other) noexcept : bits(other.bits) { other.bits = NIL; }
+
+    // The new bits are read before the old object is released, since that
+    // object may own `other` (e.g. `v = v.asArray()->elements[0]`).
+    Value& operator=(const Value& other) {
+        const uint64_t next = other.bits;
+        other.retain();
+        release();
+        bits = next;
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        const uint64_t next = other.bits;
+        other.bits = NIL;
+        release();
+        bits = next;
+        return *this;
+    }
+
+    ~Value() { release(); }
+
+    bool isNull() const { return bits == NIL; }
+    bool isBool() const { return (bits | 1) == TRUE_BITS; }
+    bool isNumber() const { return (bits & QNAN) != QNAN; }
+    bool isObject() const { return (bits & (SIGN_BIT | QNAN)) == (SIGN_BIT | QNAN); }
+    bool isString() const { return isObject() && asObject()->type == ObjectType::STRING; }
+    bool isArray() const { return isObject() && asObject()->type == ObjectType::ARRAY; }
+    bool isCallable() const { return isObject() && asObject()->type == ObjectType::CALLABLE; }
+    bool isMap() const { return isObject() && asObject()->type == ObjectType::MAP; }
+
+    bool asBool() const { return bits == TRUE_BITS; }
+
+    double asNumber() const {
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+        return number;
+    }
+
+    Object* asObject() const {
+        return reinterpret_cast<Object*>(static_cast<uintptr_t>(bits & ~(SIGN_BIT | QNAN)));
+    }
+
+    const std::string& asString() const { return static_cast<const String*>(asObject())->chars; }
+    LiteralVector* asArray() const;
+    Callable* asCallable() const;
+    LiteralMap* asMap() const;
+
+    // Numbers compare by value and strings by content; every other object
+    // only equals itself.
+    bool operator==(const Value& other) const {
+        if (isNumber() && other.isNumber()) return asNumber() == other.asNumber();
+        if (bits == other.bits) return true;
+        if (isString() && other.isString()) {
+            const auto* a = static_cast<const String*>(asObject());
+            const auto* b = static_cast<const String*>(other.asObject());
+            return !(a->interned && b->interned) && a->chars == b->chars;
+        }
+        return false;
+    }
+
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
+private:
+    static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+    static constexpr uint64_t QNAN = 0x7ffc000000000000;
+    static constexpr uint64_t NIL = QNAN | 1;
+    static constexpr uint64_t FALSE_BITS = QNAN | 2;
+    static constexpr uint64_t TRUE_BITS = QNAN | 3;
+
+    uint64_t bits;
+
+    void retain() const {
+        if (isObject()) asObject()->refCount++;
+    }
+
+    void release() const {
+        if (isObject()) {
+            Object* object = asObject();
+            if (--object->refCount == 0) delete object;
+        }
+    }
+};
+
+static_assert(sizeof(Value) == 8, "Value must stay NaN-boxed");
+
+struct LiteralVector final : Object, Traceable {
+    std::vector<Value> elements;
+
+    LiteralVector() : Object(ObjectType::ARRAY) {}
+
+    Traceable* traceable() override { return this; }
+    size_t references() const override { return refCount; }
+    void trace(Tracer& tracer) override {
+        for (const Value& element : elements) tracer.visit(element);
+    }
+    void clear() override { elements.clear(); }
+    std::shared_ptr<void> hold() override { return std::make_shared<Value>(Value(this)); }
+    size_t byteSize() const override {
+        return sizeof(LiteralVector) + elements.capacity() * sizeof(Value);
+    }
+};
+
+inline LiteralVector* Value::asArray() const {
+    return static_cast<LiteralVector*>(asObject());
+}
+
+#endif //CIPR_VALUE_H
@@ -1,17 +1,80 @@
 #include "Core/Core.h"
+#include "Common/ScriptExit.h"
+#include "Daemon/Daemon.h"
 #include <iostream>
+#include <string>
+#include <vector>
 
 int main(const int argc, char* argv[]) {
-    Core core;
-    core.loadConfig();
+    const char* script = nullptr;
+    bool useVM = false;
+    bool optimize = true;
+    bool useCache = true;
+    bool daemon = false;
+    bool client = false;
+    std::string socket = Daemon::defaultPath();
+    // Passed on to the daemon by --client.
+    std::vector<std::string> flags;
+    bool valid = true;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--vm") {
+            useVM = true;
+            flags.push_back(arg);
+        } else if (arg == "--O0" || arg == "--O1") {
+            optimize = arg == "--O1";
+            flags.push_back(arg);
+        } else if (arg == "--no-cache") {
+            useCache = false;
+            flags.push_back(arg);
+        } else if (arg == "--daemon" && !client) {
+            daemon = true;
+        } else if (arg == "--client" && !daemon) {
+            client = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socket = argv[++i];
+        } else if (script == nullptr && arg.rfind("--", 0) != 0) {
+            script = argv[i];
+        } else {
+            valid = false;
+        }
+    }
 
-    if (argc > 2) {
-        std::cout << "Usage: cipr [script]" << std::endl;
+    if (!valid || (daemon && script != nullptr) || (client && script == nullptr)) {
+        std::cout << "Usage: cipr [--vm] [--O0|--O1] [--no-cache] [script]\n"
+                     "       cipr --daemon [--socket path]\n"
+                     "       cipr --client [--socket path] [--vm] [--O0|--O1] [--no-cache] script" << std::endl;
         return 64;
-    } if (argc == 2) {
-        core.runFile(argv[1]);
-    } else {
+    }
+
+    // With no daemon listening, the script simply runs here.
+    if (client) {
+        if (int status; Daemon(socket).run(script, flags, status)) return status;
+    }
+
+    Daemon server(socket);
+    if (daemon) {
+        if (const int status = server.listen(); status != 0) return status;
+    }
+
+    Core core;
+    core.setUseVM(useVM);
+    core.setOptimize(optimize);
+    core.setUseCache(useCache);
+
+    try {
+        core.loadConfig();
+
+        if (daemon) {
+            server.serve(core);
+        }
+        if (script != nullptr) {
+            return core.runFile(script);
+        }
         core.runPrompt();
+    } catch (const ScriptExit& exit) {
+        return exit.code;
     }
     return 0;
-}
\ No newline at end of file
+}